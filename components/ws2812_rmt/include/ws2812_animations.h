@@ -1,8 +1,11 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "esp_err.h"
+#include "ws2812_blend.h"
 #include "ws2812_control.h"
+#include "ws2812_palette.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -21,21 +24,96 @@ typedef enum {
     ANIMATION_OCEAN,
     ANIMATION_AURORA,
     ANIMATION_SOLID_COLOR,
+    ANIMATION_OCEAN_NOISE,
+    ANIMATION_AURORA_NOISE,
+    ANIMATION_LAVA,
     ANIMATION_MAX
 } animation_type_t;
 
+/**
+ * @brief Configuration fields an animation reads
+ */
+typedef enum {
+    ANIMATION_PARAM_SPEED = 1 << 0, /*!< animation_config_t::speed */
+    ANIMATION_PARAM_COLOR = 1 << 1, /*!< animation_config_t::r, g and b */
+    ANIMATION_PARAM_PALETTE = 1 << 2, /*!< animation_config_t::palette */
+} animation_param_t;
+
+/**
+ * @brief Description of an animation, for user interfaces
+ */
+typedef struct {
+    const char *name;          /*!< Lower-case name, e.g. "rainbow" */
+    const char *label;         /*!< Display name, e.g. "Rainbow" */
+    uint32_t params;           /*!< animation_param_t flags of the fields the animation reads */
+} animation_effect_info_t;
+
+/**
+ * @brief Transitions from the running animation to a new one
+ */
+typedef enum {
+    ANIMATION_TRANSITION_NONE = 0, /*!< Hard cut */
+    ANIMATION_TRANSITION_FADE,     /*!< Crossfade */
+    ANIMATION_TRANSITION_WIPE,     /*!< The new animation sweeps in from the start of the strip */
+    ANIMATION_TRANSITION_DISSOLVE, /*!< LEDs switch over one by one in a scattered order */
+    ANIMATION_TRANSITION_MAX
+} animation_transition_t;
+
 /**
  * @brief Animation configuration structure
  */
 typedef struct {
     animation_type_t type;     /*!< Type of animation */
-    uint32_t speed;            /*!< Animation speed (ms between updates) */
+    uint32_t speed;            /*!< Animation speed (ms per effect step, independent of the frame rate) */
     uint32_t brightness;       /*!< LED brightness (0-255) */
     uint8_t r, g, b;          /*!< Base color for animations that use a single color */
+    animation_transition_t transition; /*!< How to switch to this animation from a different one */
+    uint32_t transition_ms;    /*!< Transition duration */
+    uint32_t seed;             /*!< Seed of animations with randomness, 0 for a new one at every start */
+    led_palette_id_t palette;  /*!< Palette of animations that use one, LED_PALETTE_NONE for the animation's own */
 } animation_config_t;
 
+/**
+ * @brief One layer of the compositor
+ *
+ * Layers are stacked by index, layer 0 at the bottom, and flattened into the
+ * strip frame every frame. Each layer runs its own animation, including its
+ * own transitions, or a table of segments set with animation_set_segments().
+ */
+typedef struct {
+    animation_config_t animation; /*!< Animation of the layer, ANIMATION_NONE leaves the layer empty */
+    uint8_t opacity;              /*!< 0 hides the layer, 255 is opaque */
+    led_blend_mode_t blend;       /*!< How the layer combines with the layers below it */
+} animation_layer_config_t;
+
+/**
+ * @brief One segment of a layer, a slice of the strip running its own animation
+ *
+ * Animations render into a span of the segment's length, or of half of it
+ * when mirrored, so every effect works on any segment size.
+ */
+typedef struct {
+    uint32_t start;               /*!< First LED of the segment */
+    uint32_t length;              /*!< Number of LEDs, at least 1 */
+    bool reverse;                 /*!< Run the animation from the last LED towards the first */
+    bool mirror;                  /*!< Render the first half and mirror it onto the second half */
+    uint8_t brightness;           /*!< Scales the animation of this segment, 255 is full */
+    animation_config_t animation; /*!< Animation of the segment */
+} animation_segment_config_t;
+
+/**
+ * @brief Frame scheduler statistics
+ */
+typedef struct {
+    uint32_t frames;           /*!< Frame deadlines served */
+    uint32_t frames_dropped;   /*!< Deadlines missed because a frame overran */
+    uint32_t frames_cached;    /*!< Frames played back from the frame cache instead of rendered */
+} animation_stats_t;
+
 /**
  * @brief Initialize the animation system
+ *
+ * Starts the render task, which runs until reboot. Call after led_strip_init().
  * 
  * @return esp_err_t ESP_OK on success, error code otherwise
  */
@@ -43,6 +121,12 @@ esp_err_t animation_init(void);
 
 /**
  * @brief Start a new animation
+ *
+ * Runs the animation on layer 0, opaque with normal blending, and sets the
+ * strip brightness from the configuration. The configuration is queued for
+ * the render task, which switches at its next frame boundary. A different
+ * animation type blends in with the configured transition while the old
+ * animation keeps running.
  * 
  * @param config Animation configuration
  * @return esp_err_t ESP_OK on success, error code otherwise
@@ -51,13 +135,113 @@ esp_err_t animation_start(const animation_config_t *config);
 
 /**
  * @brief Stop the current animation
+ *
+ * Empties every layer. The render task turns the LEDs off at its next frame
+ * boundary, using the last transition of each layer, and then sleeps until
+ * the next animation_start() or animation_set_layer().
  * 
  * @return esp_err_t ESP_OK on success, error code otherwise
  */
 esp_err_t animation_stop(void);
 
 /**
- * @brief Get the current animation configuration
+ * @brief Set the animation, opacity and blend mode of a layer
+ *
+ * Queued like animation_start(). The animation runs on the whole strip and
+ * replaces a segment table. Its brightness is not used, the strip brightness
+ * applies to the flattened frame; use the opacity to dim a layer. Layers that
+ * are empty, transparent or covered by an opaque normal layer above them are
+ * not rendered.
+ *
+ * @param layer Layer index, 0..ANIMATION_MAX_LAYERS-1
+ * @param config Layer configuration
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for a bad index or
+ *         configuration, ESP_ERR_TIMEOUT if the render task is not taking changes
+ */
+esp_err_t animation_set_layer(uint32_t layer, const animation_layer_config_t *config);
+
+/**
+ * @brief Split a layer into segments
+ *
+ * Replaces the segment table of the layer and keeps its opacity and blend
+ * mode. Segments must lie on the strip and must not overlap. LEDs outside
+ * every segment show the layers below, or black on layer 0. A segment that
+ * keeps its start, length, reverse and mirror switches to its new animation
+ * with the animation's transition; any other segment cuts over at once.
+ *
+ * @param layer Layer index, 0..ANIMATION_MAX_LAYERS-1
+ * @param segments Segment table
+ * @param count Number of segments, 0..ANIMATION_MAX_SEGMENTS
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for a bad index or
+ *         segment, ESP_ERR_TIMEOUT if the render task is not taking changes
+ */
+esp_err_t animation_set_segments(uint32_t layer, const animation_segment_config_t *segments, uint32_t count);
+
+/**
+ * @brief Get the last requested segment table of a layer
+ *
+ * @param layer Layer index, 0..ANIMATION_MAX_LAYERS-1
+ * @param[out] segments Segment table, room for ANIMATION_MAX_SEGMENTS entries
+ * @param[out] count Number of segments
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for a bad index or NULL pointer
+ */
+esp_err_t animation_get_segments(uint32_t layer, animation_segment_config_t *segments, uint32_t *count);
+
+/**
+ * @brief Get the last requested configuration of a layer
+ *
+ * The animation is the one of the first segment.
+ *
+ * @param layer Layer index, 0..ANIMATION_MAX_LAYERS-1
+ * @param[out] config Layer configuration
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for a bad index or NULL config
+ */
+esp_err_t animation_get_layer(uint32_t layer, animation_layer_config_t *config);
+
+/**
+ * @brief Look up a transition by its name
+ *
+ * @param name "none", "fade", "wipe" or "dissolve"
+ * @return animation_transition_t Transition, ANIMATION_TRANSITION_MAX if the name is unknown
+ */
+animation_transition_t animation_transition_from_name(const char *name);
+
+/**
+ * @brief Get the description of an animation type
+ *
+ * Together with ANIMATION_MAX this enumerates every animation the firmware has.
+ *
+ * @param type Animation type
+ * @return const animation_effect_info_t* Description, NULL for an unknown type
+ */
+const animation_effect_info_t *animation_get_effect_info(animation_type_t type);
+
+/**
+ * @brief Look up an animation type by its name
+ *
+ * @param name Name as found in animation_effect_info_t::name
+ * @return animation_type_t Animation type, ANIMATION_MAX if the name is unknown
+ */
+animation_type_t animation_type_from_name(const char *name);
+
+/**
+ * @brief Get the name of a transition
+ *
+ * @param transition Transition
+ * @return const char* Name as accepted by animation_transition_from_name(), NULL for an unknown transition
+ */
+const char *animation_transition_name(animation_transition_t transition);
+
+/**
+ * @brief Get the frame scheduler statistics
+ *
+ * @param[out] stats Statistics
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if stats is NULL
+ */
+esp_err_t animation_get_stats(animation_stats_t *stats);
+
+/**
+ * @brief Get the current animation configuration of layer 0
  * 
  * @param[out] config Pointer to store the current configuration
  * @return esp_err_t ESP_OK on success, error code otherwise
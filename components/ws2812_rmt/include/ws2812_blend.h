@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ws2812_pixel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Blend amount meaning "all of the second frame"
+ */
+#define LED_BLEND_FULL 256
+
+/**
+ * @brief How a layer combines with the frame below it, per channel
+ */
+typedef enum {
+    LED_BLEND_NORMAL = 0,      /*!< The layer covers the frame below */
+    LED_BLEND_ADD,             /*!< Sum, clipped at full scale */
+    LED_BLEND_MULTIPLY,        /*!< Product, only darkens */
+    LED_BLEND_SCREEN,          /*!< Inverse of the product of the inverses, only brightens */
+    LED_BLEND_MAX,             /*!< The brighter of the two */
+    LED_BLEND_MODE_MAX
+} led_blend_mode_t;
+
+/**
+ * @brief Linear interpolation between two frames, every channel in 8 bits
+ *
+ * dst = from + (to - from) * amount / 256, computed as one weighted sum per
+ * byte with no branches. dst may be the same array as from or to.
+ *
+ * @param[out] dst Blended frame
+ * @param from Frame at amount 0
+ * @param to Frame at amount LED_BLEND_FULL
+ * @param count Number of pixels
+ * @param amount Share of the second frame, 0..LED_BLEND_FULL
+ */
+void led_blend_lerp(led_color_t *dst, const led_color_t *from, const led_color_t *to, size_t count, uint16_t amount);
+
+/**
+ * @brief Blend a layer onto a frame in place
+ *
+ * Every channel of dst becomes a lerp from itself to mode(dst, src) by
+ * opacity. Each mode has its own loop, so the mode is not tested per pixel;
+ * an opaque normal layer is a plain copy.
+ *
+ * @param[inout] dst Frame below the layer, receives the result
+ * @param src Layer frame
+ * @param count Number of pixels
+ * @param mode Blend mode
+ * @param opacity Share of the blended result, 0..LED_BLEND_FULL
+ */
+void led_blend_layer(led_color_t *dst, const led_color_t *src, size_t count, led_blend_mode_t mode, uint16_t opacity);
+
+/**
+ * @brief Convert an 8-bit opacity to a blend amount, mapping 255 to LED_BLEND_FULL
+ *
+ * @param opacity Opacity, 0..255
+ * @return uint16_t Blend amount, 0..LED_BLEND_FULL
+ */
+static inline uint16_t led_blend_amount(uint8_t opacity)
+{
+    return opacity + (opacity >> 7);
+}
+
+/**
+ * @brief Get the name of a blend mode
+ *
+ * @param mode Blend mode
+ * @return const char* "normal", "add", "multiply", "screen" or "max", NULL for an unknown mode
+ */
+const char *led_blend_mode_name(led_blend_mode_t mode);
+
+/**
+ * @brief Look up a blend mode by its name
+ *
+ * @param name Name as returned by led_blend_mode_name()
+ * @return led_blend_mode_t Blend mode, LED_BLEND_MODE_MAX if the name is unknown
+ */
+led_blend_mode_t led_blend_mode_from_name(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,22 +1,44 @@
 #pragma once
 
+#if __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+
 // LED strip configuration
 #define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz resolution, 1 tick = 0.1us
 #define RMT_LED_STRIP_GPIO_NUM      17
 #define RMT_LED_STRIP_MEM_BLOCK_SYMBOLS 64
 #define RMT_LED_STRIP_TRANS_QUEUE_DEPTH 4
-#define RMT_LED_STRIP_CHASE_SPEED_MS 10
+#define RMT_LED_STRIP_FRAME_BUFFERS 2 // driver-owned frame buffers, must not exceed the trans queue depth
+#define RMT_LED_STRIP_NUM_LEDS      5    // default strip length when NVS holds none
+#define RMT_LED_STRIP_MAX_LEDS      4096 // sanity limit for the total length of all outputs
+#define RMT_LED_STRIP_MAX_OUTPUTS   4    // one output per RMT TX channel (ESP32-S2 has four)
+#define RMT_LED_STRIP_KEEPALIVE_MS  1000 // resend an unchanged frame this often, 0 to never resend it
+#define RMT_LED_STRIP_GAMMA         220  // default gamma of every channel, in hundredths (100 is linear)
+#define RMT_LED_STRIP_DITHER        1    // 1: temporal dithering of moving frames, 0: always round
+#define RMT_LED_STRIP_DITHER_FRAMES 30   // frames a still framebuffer keeps dithering before it is rounded and skipped
+#define RMT_LED_STRIP_MAX_RANGES    12   // LED ranges dimmed in the output stage, one per animation segment
+#define RMT_LED_STRIP_TABLE_ENCODER 1    // 1: expand bytes through a 256-entry symbol table, 0: generic bytes encoder
 
-// WS2812 timing constants (in microseconds)
-#define WS2812_T0H 0.3f
-#define WS2812_T0L 0.9f
-#define WS2812_T1H 0.9f
-#define WS2812_T1L 0.3f
-#define WS2812_RESET_DURATION 50.0f
+// Animation render task
+#define ANIMATION_TASK_STACK_SIZE   4096 // bytes, allocated statically
+#define ANIMATION_TASK_PRIORITY     5
+#ifdef CONFIG_WS2812_ANIMATION_FPS
+#define ANIMATION_TARGET_FPS        CONFIG_WS2812_ANIMATION_FPS // frames are rendered on deadlines at this rate
+#else
+#define ANIMATION_TARGET_FPS        60   // the Kconfig default, for builds without sdkconfig.h
+#endif
+#define ANIMATION_TRANSITION_MS     500  // default crossfade when the web API does not name a transition
+#define ANIMATION_MAX_LAYERS        3    // compositor layers, each holds two frames of the strip
+#define ANIMATION_MAX_SEGMENTS      4    // segments per layer, they share the frames of their layer
+#define ANIMATION_QUEUE_LENGTH      8    // configuration changes waiting for the next frame
+#define ANIMATION_FRAME_CACHE_SIZE  (512 * 1024) // bytes of wire-ready frames of periodic animations, in PSRAM
+#define ANIMATION_FRAME_CACHE_INTERNAL_SIZE (32 * 1024) // bytes of internal RAM used instead without PSRAM, 0 to render live
+#define ANIMATION_FRAME_CACHE_FILL  4    // frames added to the cache per frame while it fills
+#define LED_PALETTE_USER_SLOTS      4    // palettes uploaded at runtime, each with a 1 KB color table
 
-// HSV to RGB conversion constants
-#define HSV_RGB_MAX 2.55f
-#define HSV_RGB_MIN_DIVISOR 100.0f
-#define HSV_HUE_MAX 360
-#define HSV_SATURATION_MAX 100
-#define HSV_VALUE_MAX 100 
\ No newline at end of file
+// SPI output backend configuration
+#define LED_STRIP_SPI_TOLERANCE_NS  150    // largest pulse error of an SPI output, timings that need more are refused
+#define LED_STRIP_SPI_MAX_OUTPUTS   2      // SPI2 and SPI3 are free for LED outputs
+#define RMT_LED_STRIP_NVS_NAMESPACE "led_strip"
+ 
\ No newline at end of file
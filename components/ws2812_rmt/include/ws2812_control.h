@@ -4,43 +4,111 @@
 #include "driver/rmt_encoder.h"
 #include "esp_err.h"
 #include "ws2812_config.h"
+#include "ws2812_pixel.h"
+#include "ws2812_timing.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 /**
- * @brief Number of LEDs in the strip
+ * @brief LED output backends
  */
-#define NUM_LEDS 5
+typedef enum {
+    LED_STRIP_BACKEND_RMT = 0, /*!< RMT TX channel, refilled from the RMT ISR */
+    LED_STRIP_BACKEND_SPI,     /*!< SPI MOSI with the whole frame in one DMA buffer, up to two outputs */
+    LED_STRIP_BACKEND_MAX
+} led_strip_backend_t;
+
+/**
+ * @brief LED strip output configuration structure
+ *
+ * Each output drives one segment of the logical frame on its own data line.
+ */
+typedef struct {
+    led_strip_backend_t backend;/*!< Backend driving this output */
+    led_pixel_format_t pixel_format;/*!< Channel order and count of the strip on this output */
+    led_timing_profile_t timing;/*!< Bit timing of the chips on this output */
+    uint8_t gpio_num;          /*!< GPIO number for this output's data line */
+    uint32_t num_leds;         /*!< Number of LEDs driven by this output */
+} led_strip_output_config_t;
 
 /**
  * @brief LED strip configuration structure
  */
 typedef struct {
     uint32_t resolution_hz;    /*!< RMT resolution in Hz */
-    uint8_t gpio_num;          /*!< GPIO number for LED data line */
-    uint32_t mem_block_symbols;/*!< Number of RMT memory block symbols */
+    uint32_t mem_block_symbols;/*!< Number of RMT memory block symbols per channel */
     uint32_t trans_queue_depth;/*!< RMT transaction queue depth */
+    led_pixel_gamma_t gamma;   /*!< Per-channel gamma of the output stage */
+    uint32_t num_outputs;      /*!< Number of outputs in use */
+    led_strip_output_config_t outputs[RMT_LED_STRIP_MAX_OUTPUTS]; /*!< Outputs, in frame order */
 } led_strip_config_t;
 
 /**
  * @brief LED strip state structure
  */
 typedef struct {
-    uint8_t leds[NUM_LEDS * 3]; /*!< Array of LED RGB values (GRB format) */
+    led_color_t *pixels;       /*!< Array of canonical pixels */
+    uint32_t num_leds;         /*!< Number of LEDs in the array */
 } led_strip_state_t;
 
+/**
+ * @brief A range of LEDs with its own brightness, see led_strip_set_ranges()
+ */
+typedef struct {
+    uint32_t start;            /*!< First LED of the range */
+    uint32_t length;           /*!< Number of LEDs in the range */
+    uint8_t brightness;        /*!< Brightness relative to the global brightness, 0-255 */
+} led_strip_range_t;
+
+/**
+ * @brief LED strip statistics, counted since led_strip_init()
+ */
+typedef struct {
+    uint32_t frames_sent;      /*!< Frames handed to the outputs */
+    uint32_t frames_skipped;   /*!< Frames not sent because they matched the last one */
+    uint32_t keepalives;       /*!< Unchanged frames sent anyway as a keepalive, included in frames_sent */
+} led_strip_stats_t;
+
 /**
  * @brief LED strip encoder configuration structure
  */
 typedef struct {
     uint32_t resolution; /*!< Encoder resolution, in Hz */
+    const led_timing_t *timing; /*!< Bit timing, NULL for WS2812B */
 } led_strip_encoder_config_t;
 
+/**
+ * @brief Create the generic WS2812 encoder (bytes encoder followed by the reset code)
+ *
+ * @param config Encoder configuration
+ * @param[out] ret_encoder Returned encoder handle
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+
+/**
+ * @brief Create the table-driven WS2812 encoder
+ *
+ * Produces the same symbols as rmt_new_led_strip_encoder(), but expands each
+ * byte through a table of 8 symbols per byte value that is built once here,
+ * so refilling the channel memory in the RMT ISR is a series of word copies.
+ * The table takes 8 KiB per encoder.
+ *
+ * @param config Encoder configuration
+ * @param[out] ret_encoder Returned encoder handle
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t rmt_new_led_strip_table_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+
 /**
  * @brief Convert HSV color to RGB
- * 
+ *
+ * Standard spectrum with narrow yellow, so h=60 s=100 v=100 is (255, 255, 0).
+ * The effects use the 8-bit led_hsv2rgb() instead, whose rainbow mapping
+ * gives the same hues other colors.
+ *
  * @param h Hue value (0-359)
  * @param s Saturation value (0-100)
  * @param v Value/brightness (0-100)
@@ -50,21 +118,199 @@ typedef struct {
  */
 void led_strip_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b);
 
+/**
+ * @brief Fill a configuration with the compile-time defaults
+ *
+ * @param[out] config Configuration to fill
+ */
+void led_strip_get_default_config(led_strip_config_t *config);
+
+/**
+ * @brief Load the LED strip configuration from NVS
+ *
+ * Starts from the defaults and overrides the values stored in NVS. Missing
+ * keys keep their default value, so a fresh device works without setup.
+ * NVS must already be initialized.
+ *
+ * @param[out] config Configuration to fill
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t led_strip_load_config(led_strip_config_t *config);
+
+/**
+ * @brief Store the persistent parts of the LED strip configuration in NVS
+ *
+ * The new values take effect at the next led_strip_init(), i.e. after a restart.
+ *
+ * @param config Configuration to store
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t led_strip_store_config(const led_strip_config_t *config);
+
 /**
  * @brief Initialize the LED strip
+ *
+ * Allocates the frame buffers once for the total length of all outputs, from
+ * internal RAM if possible and from PSRAM otherwise. The frame is split into
+ * consecutive segments, one per output, which are transmitted in parallel.
  * 
  * @param config LED strip configuration (NULL for default values)
  * @return esp_err_t ESP_OK on success, error code otherwise
  */
 esp_err_t led_strip_init(const led_strip_config_t *config);
 
+/**
+ * @brief Get the number of LEDs the strip was initialized with, over all outputs
+ *
+ * @return uint32_t Number of LEDs, 0 before led_strip_init()
+ */
+uint32_t led_strip_get_num_leds(void);
+
 /**
  * @brief Set LED strip colors
+ *
+ * Copies the pixels into the framebuffer and shows them with led_strip_show().
  * 
- * @param led_strip_state Pointer to LED state array (GRB format)
+ * @param led_strip_state Pointer to led_strip_get_num_leds() canonical pixels
  * @return esp_err_t ESP_OK on success, error code otherwise
  */
-esp_err_t led_strip_set(uint8_t *led_strip_state);
+esp_err_t led_strip_set(const led_color_t *led_strip_state);
+
+/**
+ * @brief Get the framebuffer
+ *
+ * Render code draws canonical pixels here and calls led_strip_show(). It
+ * never needs to know the wire format of the outputs. led_strip_set() copies
+ * into the same pixels, so render code that may run alongside it draws only
+ * after led_strip_acquire_frame(), which holds off led_strip_set() until the
+ * led_strip_show() that follows.
+ *
+ * @return led_color_t* led_strip_get_num_leds() pixels, NULL before led_strip_init()
+ */
+led_color_t *led_strip_get_pixels(void);
+
+/**
+ * @brief Send the framebuffer to the strip
+ *
+ * Runs the framebuffer through the output stage (gamma lookup and temporal
+ * dithering) and packs it into the back buffer, one tight loop per output in
+ * its wire format, and submits it. The framebuffer may be drawn again as soon as
+ * this returns, while the frame is still on the wire.
+ *
+ * A framebuffer left unchanged for RMT_LED_STRIP_DITHER_FRAMES calls stops
+ * dithering and is rounded, so calling this every frame for a still scene
+ * ends in skipped frames.
+ *
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t led_strip_show(void);
+
+/**
+ * @brief Run pixels through the output stage into wire bytes without sending them
+ *
+ * The same as led_strip_show() does to the framebuffer, at the current
+ * brightness, so a frame packed once can be sent again later through
+ * led_strip_acquire_frame() and led_strip_submit_frame(). Every channel is
+ * rounded instead of dithered, the dither error carried between shown frames
+ * is left as it is.
+ *
+ * @param src led_strip_get_num_leds() pixels
+ * @param[out] frame led_strip_get_frame_size() bytes, the outputs' segments in their wire formats
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t led_strip_pack(const led_color_t *src, uint8_t *frame);
+
+/**
+ * @brief Get the size of one frame in wire bytes, over all outputs
+ *
+ * @return size_t Bytes, 0 before led_strip_init()
+ */
+size_t led_strip_get_frame_size(void);
+
+/**
+ * @brief Acquire the back buffer to fill with wire bytes directly
+ *
+ * The driver owns RMT_LED_STRIP_FRAME_BUFFERS frame buffers. While the outputs
+ * drain the front buffers, the caller fills the back buffer. This only blocks
+ * when every other buffer is still queued or on the wire. Calling it again
+ * before led_strip_submit_frame() returns the same buffer. Most callers want
+ * led_strip_get_pixels() and led_strip_show() instead.
+ *
+ * The calling task owns the back buffer until its led_strip_submit_frame(),
+ * other tasks wait here until then. Every successful call must be followed
+ * by a submit from the same task.
+ *
+ * @param[out] frame Pointer to the back buffer, the outputs' segments in their wire formats
+ * @param timeout_ms Maximum time to wait for a free buffer, -1 to wait forever
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT if no buffer became free or another task kept it
+ */
+esp_err_t led_strip_acquire_frame(uint8_t **frame, int timeout_ms);
+
+/**
+ * @brief Queue the acquired back buffer for transmission
+ *
+ * Returns as soon as the frame is queued. The buffer is handed back to the
+ * driver and becomes free again once the RMT channel reports it as sent.
+ *
+ * A frame that is byte-identical to the last one sent is skipped, unless
+ * RMT_LED_STRIP_KEEPALIVE_MS have passed since then. A skipped buffer stays
+ * acquired, so the next led_strip_acquire_frame() returns it again.
+ *
+ * Ends the calling task's ownership of the back buffer in every case.
+ *
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if the calling task did not acquire it,
+ *         error code otherwise
+ */
+esp_err_t led_strip_submit_frame(void);
+
+/**
+ * @brief Set the global brightness
+ *
+ * The brightness is folded into the output stage lookup tables on the next
+ * led_strip_show(), so it applies to every effect at no cost per pixel. Render
+ * code should draw at full brightness.
+ *
+ * @param brightness Brightness, 0-255
+ */
+void led_strip_set_brightness(uint8_t brightness);
+
+/**
+ * @brief Get the global brightness
+ *
+ * @return uint8_t Brightness, 0-255
+ */
+uint8_t led_strip_get_brightness(void);
+
+/**
+ * @brief Dim ranges of the strip in the output stage
+ *
+ * The 8.8 levels of every LED in a range are scaled after the gamma lookup,
+ * so a dimmed range keeps the precision that scaling its 8-bit pixels would
+ * lose, the same as the global brightness. LEDs outside every range are not
+ * scaled. The ranges replace those of the last call and apply from the next
+ * frame packed.
+ *
+ * @param ranges Ranges sorted by start, not overlapping and on the strip
+ * @param count Number of ranges, at most RMT_LED_STRIP_MAX_RANGES, 0 to scale no LED
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for invalid ranges
+ */
+esp_err_t led_strip_set_ranges(const led_strip_range_t *ranges, uint32_t count);
+
+/**
+ * @brief Get the frame statistics
+ *
+ * @param[out] stats Statistics
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if stats is NULL
+ */
+esp_err_t led_strip_get_stats(led_strip_stats_t *stats);
+
+/**
+ * @brief Wait until every submitted frame has been sent
+ *
+ * @param timeout_ms Maximum time to wait, -1 to wait forever
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT on timeout
+ */
+esp_err_t led_strip_wait_done(int timeout_ms);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Angles are uint16_t fractions of a full turn, they wrap for free
+ */
+#define LED_ANGLE_QUARTER 0x4000
+
+/**
+ * @brief Convert radians to angle units, for constants only
+ */
+#define LED_ANGLE_FROM_RAD(rad) ((uint16_t)((rad) * 65536.0 / 6.283185307179586 + 0.5))
+
+/**
+ * @brief Sine from a 256-entry table with linear interpolation
+ *
+ * Integer only, for effects that run per pixel on chips without an FPU.
+ *
+ * @param angle Angle, 65536 is a full turn
+ * @return int16_t sin(angle) in Q15, -32767..32767
+ */
+int16_t led_sin16(uint16_t angle);
+
+/**
+ * @brief Cosine, see led_sin16()
+ *
+ * @param angle Angle, 65536 is a full turn
+ * @return int16_t cos(angle) in Q15, -32767..32767
+ */
+int16_t led_cos16(uint16_t angle);
+
+/**
+ * @brief Sine shifted into 0..1, for brightness waves
+ *
+ * @param angle Angle, 65536 is a full turn
+ * @return uint16_t (sin(angle) + 1) / 2 in Q16, 1..65535
+ */
+uint16_t led_wave16(uint16_t angle);
+
+#ifdef __cplusplus
+}
+#endif
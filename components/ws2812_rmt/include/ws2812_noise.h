@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Most octaves led_noise16_octaves() and the fills sum
+ */
+#define LED_NOISE_MAX_OCTAVES 4
+
+/**
+ * @brief Value noise at a point of 3D space
+ *
+ * Coordinates are Q16 lattice units: the integer part picks a cell of a
+ * 65536-cell lattice, which wraps around, and the fraction is interpolated
+ * with a smoothstep, so the noise is continuous everywhere. Integer only,
+ * one hash per cell corner.
+ *
+ * @param x X in Q16
+ * @param y Y in Q16
+ * @param z Z in Q16
+ * @return uint16_t Noise, 0-65535
+ */
+uint16_t led_noise16_3d(uint32_t x, uint32_t y, uint32_t z);
+
+/**
+ * @brief Value noise in 2D, the same as led_noise16_3d() at z = 0 for half the work
+ *
+ * @param x X in Q16
+ * @param y Y in Q16
+ * @return uint16_t Noise, 0-65535
+ */
+uint16_t led_noise16_2d(uint32_t x, uint32_t y);
+
+/**
+ * @brief Value noise in 1D, the same as led_noise16_3d() at y = z = 0
+ *
+ * @param x X in Q16
+ * @return uint16_t Noise, 0-65535
+ */
+uint16_t led_noise16_1d(uint32_t x);
+
+/**
+ * @brief 8-bit value noise in 3D, see led_noise16_3d()
+ */
+static inline uint8_t led_noise8_3d(uint32_t x, uint32_t y, uint32_t z)
+{
+    return led_noise16_3d(x, y, z) >> 8;
+}
+
+/**
+ * @brief 8-bit value noise in 2D, see led_noise16_2d()
+ */
+static inline uint8_t led_noise8_2d(uint32_t x, uint32_t y)
+{
+    return led_noise16_2d(x, y) >> 8;
+}
+
+/**
+ * @brief 8-bit value noise in 1D, see led_noise16_1d()
+ */
+static inline uint8_t led_noise8_1d(uint32_t x)
+{
+    return led_noise16_1d(x) >> 8;
+}
+
+/**
+ * @brief Octaves of 3D value noise
+ *
+ * Every octave has twice the frequency and half the weight of the one
+ * before, and its own lattice, for finer detail on top of the coarse shape.
+ * The weights add up to 1, so the result keeps the range of one octave.
+ *
+ * @param x X in Q16
+ * @param y Y in Q16
+ * @param z Z in Q16
+ * @param octaves Number of octaves, 1..LED_NOISE_MAX_OCTAVES
+ * @return uint16_t Noise, 0-65535
+ */
+uint16_t led_noise16_octaves(uint32_t x, uint32_t y, uint32_t z, uint32_t octaves);
+
+/**
+ * @brief Fill a buffer with octaves of noise along a line in x
+ *
+ * dst[i] is led_noise16_octaves(x + i * dx, y, z, octaves), up to rounding.
+ * The lattice is only hashed where the line enters a new cell, so a pixel
+ * costs one smoothstep and one interpolation per octave, whatever the
+ * dimension.
+ *
+ * @param[out] dst Buffer
+ * @param count Number of values
+ * @param x X of the first value in Q16
+ * @param dx X step between values in Q16
+ * @param y Y in Q16
+ * @param z Z in Q16
+ * @param octaves Number of octaves, 1..LED_NOISE_MAX_OCTAVES
+ */
+void led_noise16_fill(uint16_t *dst, size_t count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z,
+                      uint32_t octaves);
+
+/**
+ * @brief 8-bit version of led_noise16_fill()
+ *
+ * @param[out] dst Buffer
+ * @param count Number of values
+ * @param x X of the first value in Q16
+ * @param dx X step between values in Q16
+ * @param y Y in Q16
+ * @param z Z in Q16
+ * @param octaves Number of octaves, 1..LED_NOISE_MAX_OCTAVES
+ */
+void led_noise8_fill(uint8_t *dst, size_t count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z,
+                     uint32_t octaves);
+
+#ifdef __cplusplus
+}
+#endif
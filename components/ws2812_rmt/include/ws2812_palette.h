@@ -0,0 +1,128 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "ws2812_config.h"
+#include "ws2812_pixel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Most color stops of one palette
+ */
+#define LED_PALETTE_MAX_STOPS 16
+
+/**
+ * @brief Bytes of a palette name, including the terminating NUL
+ */
+#define LED_PALETTE_NAME_LEN 16
+
+/**
+ * @brief Palettes, the built-in ones followed by the slots for uploaded ones
+ */
+typedef enum {
+    LED_PALETTE_NONE = 0,      /*!< No palette, effects fall back to their own */
+    LED_PALETTE_RAINBOW,       /*!< The hue wheel of led_hsv2rgb() */
+    LED_PALETTE_HEAT,          /*!< Black, red, yellow, white */
+    LED_PALETTE_OCEAN,         /*!< Deep to light blue */
+    LED_PALETTE_AURORA,        /*!< Green over teal to purple */
+    LED_PALETTE_LAVA,          /*!< Black, dark red, orange, pale yellow */
+    LED_PALETTE_FOREST,        /*!< Dark to yellowish green */
+    LED_PALETTE_USER,          /*!< First of LED_PALETTE_USER_SLOTS uploaded palettes */
+    LED_PALETTE_MAX = LED_PALETTE_USER + LED_PALETTE_USER_SLOTS
+} led_palette_id_t;
+
+/**
+ * @brief One color stop of a gradient
+ */
+typedef struct {
+    uint8_t pos;               /*!< Position along the gradient, 0..255 */
+    uint8_t r, g, b;           /*!< Color at the position */
+} led_palette_stop_t;
+
+/**
+ * @brief A named gradient
+ *
+ * Colors are interpolated linearly between neighbouring stops. Before the
+ * first stop and after the last one the color of that stop holds.
+ */
+typedef struct {
+    char name[LED_PALETTE_NAME_LEN];                /*!< Lower-case name, e.g. "ocean" */
+    uint8_t num_stops;                              /*!< Number of stops, 1..LED_PALETTE_MAX_STOPS */
+    led_palette_stop_t stops[LED_PALETTE_MAX_STOPS]; /*!< Stops in ascending position, equal positions make a hard edge */
+} led_palette_t;
+
+/**
+ * @brief Compile a palette into a 256-entry color table
+ *
+ * @param palette Palette, see led_palette_valid()
+ * @param[out] lut Color of every position 0..255
+ */
+void led_palette_build(const led_palette_t *palette, led_color_t lut[256]);
+
+/**
+ * @brief Check a palette: a name, 1..LED_PALETTE_MAX_STOPS stops, positions not descending
+ *
+ * @param palette Palette
+ * @return true if the palette can be used
+ */
+bool led_palette_valid(const led_palette_t *palette);
+
+/**
+ * @brief Look up a palette by its name
+ *
+ * @param name Palette name
+ * @return led_palette_id_t Palette, LED_PALETTE_NONE if there is none by that name
+ */
+led_palette_id_t led_palette_find(const char *name);
+
+/**
+ * @brief Get a copy of a palette
+ *
+ * @param id Palette
+ * @param[out] palette Copy of the palette
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND for an empty slot or unknown palette
+ */
+esp_err_t led_palette_get(led_palette_id_t id, led_palette_t *palette);
+
+/**
+ * @brief Upload a palette
+ *
+ * Replaces the uploaded palette of the same name, or takes a free slot. Its
+ * color table is rebuilt by the next led_palette_update(), not here, so this
+ * may be called from any task.
+ *
+ * @param palette Palette
+ * @param[out] id Slot of the palette, may be NULL
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for an invalid palette or
+ *         the name of a built-in one, ESP_ERR_NO_MEM if every slot is taken
+ */
+esp_err_t led_palette_set(const led_palette_t *palette, led_palette_id_t *id);
+
+/**
+ * @brief Rebuild the color tables of palettes that changed
+ *
+ * Only called by the task that reads the tables, so a table never changes
+ * while it is read. Cheap when nothing changed.
+ *
+ * @return true if a table was rebuilt
+ */
+bool led_palette_update(void);
+
+/**
+ * @brief Get the color table of a palette
+ *
+ * The table stays at the same address for the whole run and is only
+ * rewritten by led_palette_update().
+ *
+ * @param id Palette
+ * @return const led_color_t* 256 colors, NULL for an empty slot or unknown palette
+ */
+const led_color_t *led_palette_lut(led_palette_id_t id);
+
+#ifdef __cplusplus
+}
+#endif
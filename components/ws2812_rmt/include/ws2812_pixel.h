@@ -0,0 +1,160 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ws2812_config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Canonical pixel, used by all render code
+ *
+ * The white channel is only sent to RGBW strips and ignored for RGB strips.
+ */
+typedef struct {
+    uint8_t r;                 /*!< Red (0-255) */
+    uint8_t g;                 /*!< Green (0-255) */
+    uint8_t b;                 /*!< Blue (0-255) */
+    uint8_t w;                 /*!< White (0-255) */
+} led_color_t;
+
+/**
+ * @brief 8-bit HSV color
+ */
+typedef struct {
+    uint8_t h;                 /*!< Hue, 256 is a full turn */
+    uint8_t s;                 /*!< Saturation (0-255) */
+    uint8_t v;                 /*!< Value (0-255) */
+} led_hsv_t;
+
+/**
+ * @brief Wire formats: channel order and channel count of a strip
+ */
+typedef enum {
+    LED_PIXEL_FORMAT_GRB = 0,  /*!< WS2812, WS2812B, SK6812 RGB */
+    LED_PIXEL_FORMAT_RGB,      /*!< WS2811, WS2815 */
+    LED_PIXEL_FORMAT_BGR,      /*!< Some APA106 variants */
+    LED_PIXEL_FORMAT_GRBW,     /*!< SK6812 RGBW */
+    LED_PIXEL_FORMAT_RGBW,     /*!< RGBW strips with red first */
+    LED_PIXEL_FORMAT_MAX
+} led_pixel_format_t;
+
+/**
+ * @brief Per-channel gamma, in hundredths (100 is linear, 220 is gamma 2.2)
+ */
+typedef struct {
+    uint16_t r;                /*!< Red gamma */
+    uint16_t g;                /*!< Green gamma */
+    uint16_t b;                /*!< Blue gamma */
+    uint16_t w;                /*!< White gamma */
+} led_pixel_gamma_t;
+
+/**
+ * @brief Output stage lookup tables
+ *
+ * Map every 8-bit channel level to the level sent to the strip, in 8.8 fixed
+ * point. The fraction is carried to the next frame by temporal dithering, so
+ * dark levels between two 8-bit steps still come out right on average.
+ */
+typedef struct {
+    uint16_t r[256];           /*!< Red levels */
+    uint16_t g[256];           /*!< Green levels */
+    uint16_t b[256];           /*!< Blue levels */
+    uint16_t w[256];           /*!< White levels */
+} led_pixel_lut_t;
+
+/**
+ * @brief Scale of the packers that keeps the output stage levels as they are
+ */
+#define LED_PIXEL_SCALE_FULL 256
+
+/**
+ * @brief Packer running the output stage and converting canonical pixels to one wire format
+ *
+ * @param src Canonical pixels
+ * @param[out] dst Wire bytes, count * led_pixel_format_bytes() bytes
+ * @param count Number of pixels
+ * @param lut Output stage lookup tables
+ * @param[inout] dither Dither error of every pixel channel, carried between frames,
+ *                      NULL to round every channel instead
+ * @param scale Q8 scale of the 8.8 levels, applied ahead of the dither,
+ *              LED_PIXEL_SCALE_FULL to keep them
+ */
+typedef void (*led_pixel_packer_t)(const led_color_t *src, uint8_t *dst, size_t count,
+                                   const led_pixel_lut_t *lut, led_color_t *dither, uint16_t scale);
+
+/**
+ * @brief Build the output stage lookup tables
+ *
+ * Uses floating point, so call it when the gamma changes, not per frame.
+ *
+ * @param[out] lut Lookup tables
+ * @param gamma Per-channel gamma
+ */
+void led_pixel_lut_build(led_pixel_lut_t *lut, const led_pixel_gamma_t *gamma);
+
+/**
+ * @brief Scale lookup tables by a brightness, with integer math only
+ *
+ * Folding the brightness into the tables makes dimming free per frame, and
+ * since the scaling happens before the 8-bit cut, the dither keeps the
+ * precision that a scaled 8-bit level would lose.
+ *
+ * @param[out] lut Scaled tables
+ * @param base Tables at full brightness
+ * @param brightness Q8 scale, 255 keeps the base levels
+ */
+void led_pixel_lut_scale(led_pixel_lut_t *lut, const led_pixel_lut_t *base, uint8_t brightness);
+
+/**
+ * @brief Convert one 8-bit HSV color to RGB
+ *
+ * Uses the "rainbow" hue mapping: eight equal hue sections with yellow as wide
+ * as the other colors, instead of the narrow yellow of the standard spectrum.
+ * Needs no division; value is linear since the output stage applies gamma.
+ *
+ * @param hsv HSV color
+ * @return led_color_t RGB color, white channel 0
+ */
+led_color_t led_hsv2rgb(led_hsv_t hsv);
+
+/**
+ * @brief Get the number of wire bytes per pixel of a format
+ *
+ * @param format Wire format
+ * @return size_t 3 or 4, 0 for an unknown format
+ */
+size_t led_pixel_format_bytes(led_pixel_format_t format);
+
+/**
+ * @brief Get the packer of a format
+ *
+ * Each packer is specialized for its channel order and count at compile time,
+ * so packing a frame is one loop without per-pixel branches.
+ *
+ * @param format Wire format
+ * @return led_pixel_packer_t Packer, NULL for an unknown format
+ */
+led_pixel_packer_t led_pixel_get_packer(led_pixel_format_t format);
+
+/**
+ * @brief Get the lower-case name of a format, e.g. "grb"
+ *
+ * @param format Wire format
+ * @return const char* Name, "unknown" for an unknown format
+ */
+const char *led_pixel_format_name(led_pixel_format_t format);
+
+/**
+ * @brief Look up a format by its name
+ *
+ * @param name Format name as returned by led_pixel_format_name()
+ * @return led_pixel_format_t Format, LED_PIXEL_FORMAT_MAX if the name is unknown
+ */
+led_pixel_format_t led_pixel_format_from_name(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief xorshift32 generator state
+ *
+ * Every effect keeps its own generator, so there is no shared state or lock,
+ * and a seeded effect renders the same frames every time.
+ */
+typedef struct {
+    uint32_t state;            /*!< Never 0 */
+} led_rand_t;
+
+/**
+ * @brief Seed a generator
+ *
+ * @param rng Generator
+ * @param seed Any value, including 0
+ */
+void led_rand_seed(led_rand_t *rng, uint32_t seed);
+
+/**
+ * @brief Next 32 random bits
+ *
+ * Three shifts and three XORs, no multiply.
+ *
+ * @param rng Generator
+ * @return uint32_t Random value
+ */
+static inline uint32_t led_rand32(led_rand_t *rng)
+{
+    uint32_t x = rng->state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rng->state = x;
+    return x;
+}
+
+/**
+ * @brief Random byte, from the high bits, which are the better ones
+ *
+ * @param rng Generator
+ * @return uint8_t Random value
+ */
+static inline uint8_t led_rand8(led_rand_t *rng)
+{
+    return led_rand32(rng) >> 24;
+}
+
+/**
+ * @brief Random value in 0..range-1, by multiply and shift instead of modulo
+ *
+ * @param rng Generator
+ * @param range Number of values, 1..65536
+ * @return uint32_t Random value
+ */
+static inline uint32_t led_rand_range(led_rand_t *rng, uint32_t range)
+{
+    return ((led_rand32(rng) >> 16) * range) >> 16;
+}
+
+/**
+ * @brief Fill a buffer with random bytes, four bytes per step of the generator
+ *
+ * @param rng Generator
+ * @param[out] dst Buffer
+ * @param size Number of bytes
+ */
+void led_rand_fill(led_rand_t *rng, uint8_t *dst, size_t size);
+
+/**
+ * @brief Fill a buffer with random bytes in base..base+range-1
+ *
+ * @param rng Generator
+ * @param[out] dst Buffer
+ * @param size Number of bytes
+ * @param base Smallest value
+ * @param range Number of values, 1..256, base + range must not exceed 256
+ */
+void led_rand_fill_range(led_rand_t *rng, uint8_t *dst, size_t size, uint8_t base, uint32_t range);
+
+#ifdef __cplusplus
+}
+#endif
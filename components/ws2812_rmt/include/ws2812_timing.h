@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Named LED chip timing profiles
+ */
+typedef enum {
+    LED_TIMING_WS2812B = 0,    /*!< WS2812B, WS2812 and clones at 800 kHz */
+    LED_TIMING_WS2811,         /*!< WS2811 in 400 kHz low speed mode */
+    LED_TIMING_SK6812,         /*!< SK6812, RGB and RGBW */
+    LED_TIMING_APA106,         /*!< APA106 and PL9823 */
+    LED_TIMING_WS2815,         /*!< WS2815 12 V strips */
+    LED_TIMING_CUSTOM,         /*!< Timing from the CONFIG_WS2812_* Kconfig options */
+    LED_TIMING_MAX
+} led_timing_profile_t;
+
+/**
+ * @brief Bit timing of one chip, in nanoseconds
+ */
+typedef struct {
+    const char *name;          /*!< Lower-case profile name, e.g. "ws2812b" */
+    uint32_t t0h_ns;           /*!< High time of a 0 bit */
+    uint32_t t0l_ns;           /*!< Low time of a 0 bit */
+    uint32_t t1h_ns;           /*!< High time of a 1 bit */
+    uint32_t t1l_ns;           /*!< Low time of a 1 bit */
+    uint32_t reset_us;         /*!< Low time that latches a frame */
+} led_timing_t;
+
+/**
+ * @brief Bit timing converted to ticks of one clock resolution
+ */
+typedef struct {
+    uint16_t t0h;              /*!< High ticks of a 0 bit */
+    uint16_t t0l;              /*!< Low ticks of a 0 bit */
+    uint16_t t1h;              /*!< High ticks of a 1 bit */
+    uint16_t t1l;              /*!< Low ticks of a 1 bit */
+    uint16_t reset_half;       /*!< Half of the reset ticks, one RMT symbol holds two halves */
+} led_timing_ticks_t;
+
+/**
+ * @brief Get the timing of a profile
+ *
+ * @param profile Timing profile
+ * @return const led_timing_t* Timing, NULL for an unknown profile
+ */
+const led_timing_t *led_timing_get(led_timing_profile_t profile);
+
+/**
+ * @brief Look up a profile by its name
+ *
+ * @param name Profile name as found in led_timing_t::name
+ * @return led_timing_profile_t Profile, LED_TIMING_MAX if the name is unknown
+ */
+led_timing_profile_t led_timing_from_name(const char *name);
+
+/**
+ * @brief Convert a timing to ticks with integer math, rounding to the nearest tick
+ *
+ * Done once when an output is created, never per bit.
+ *
+ * @param timing Timing to convert
+ * @param resolution_hz Tick rate, a multiple of 1 MHz
+ * @param[out] ticks Converted timing
+ * @return true on success, false if a duration is zero or does not fit an RMT symbol
+ */
+bool led_timing_to_ticks(const led_timing_t *timing, uint32_t resolution_hz, led_timing_ticks_t *ticks);
+
+/**
+ * @brief Get the period of one data bit of a timing
+ *
+ * The longer of the 0 and 1 bit periods, so a bit at this rate never cuts a
+ * pulse short. A fixed-clock backend still has to check the pulses of the
+ * shorter bit against its tolerance.
+ *
+ * @param timing Timing
+ * @return uint32_t Period in ns
+ */
+uint32_t led_timing_period_ns(const led_timing_t *timing);
+
+/**
+ * @brief Get the data bit rate of a timing, one bit per led_timing_period_ns()
+ *
+ * Used by backends that can only place edges on a fixed clock, such as SPI.
+ *
+ * @param timing Timing
+ * @return uint32_t Bits per second
+ */
+uint32_t led_timing_bit_rate_hz(const led_timing_t *timing);
+
+#ifdef __cplusplus
+}
+#endif
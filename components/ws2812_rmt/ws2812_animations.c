@@ -1,244 +1,845 @@
+#include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "ws2812_animations.h"
+#include "ws2812_blend.h"
 #include "ws2812_control.h"
+#include "ws2812_effect.h"
+#include "ws2812_frame_cache.h"
 
 static const char *TAG = "led_animations";
 
+// The full configuration of one layer, queued for the render task
+typedef struct {
+    uint32_t layer;
+    uint8_t opacity;
+    led_blend_mode_t blend;
+    uint32_t num_segments;
+    animation_segment_config_t segments[ANIMATION_MAX_SEGMENTS];
+} animation_command_t;
+
+// The render task and its queue live for the whole run and are allocated
+// statically, so switching effects never touches the heap
+static StackType_t animation_task_stack[ANIMATION_TASK_STACK_SIZE];
+static StaticTask_t animation_task_tcb;
 static TaskHandle_t animation_task_handle = NULL;
+static uint8_t animation_queue_storage[ANIMATION_QUEUE_LENGTH * sizeof(animation_command_t)];
+static StaticQueue_t animation_queue_struct;
 static QueueHandle_t animation_queue = NULL;
-static animation_config_t current_config = {0};
-static uint8_t led_buffer[NUM_LEDS * 3] = {0};
+static animation_command_t requested[ANIMATION_MAX_LAYERS]; // last requested configuration of every layer
+static esp_timer_handle_t frame_timer = NULL;
+static uint16_t *effect_scratch = NULL; // span::scratch of every effect
+static animation_stats_t stats;
+
+// One running effect: its configuration, its state and the span it renders
+// into, which is kept between frames so an effect only renders when it moves
+typedef struct {
+    animation_config_t config;
+    const animation_effect_def_t *def;
+    animation_span_t span;
+    bool dirty;             // render on the next frame even without a step
+    int64_t step_us;        // elapsed time not yet turned into phase, in Q16
+    animation_clock_t clock;
+    _Alignas(8) uint8_t state[ANIMATION_EFFECT_STATE_SIZE]; // owned by the effect kernel
+} animation_effect_t;
+
+// One segment of a layer. It holds two effects, so the old one keeps running
+// while a transition blends it out; both render into the segment's slice of
+// the layer frames.
+typedef struct {
+    animation_segment_config_t config;
+    animation_effect_t effects[2];
+    int current;
+    bool transitioning;
+    int64_t transition_start_us;
+    uint16_t amount;        // transition progress, 0..LED_BLEND_FULL
+} animation_segment_t;
+
+// One compositor layer: its segments and how they blend onto the layers below
+typedef struct {
+    animation_segment_t segments[ANIMATION_MAX_SEGMENTS];
+    uint32_t num_segments;
+    led_color_t *frames[2]; // effect frames, every segment owns the same slice of both
+    uint8_t *led_states[2]; // per-LED effect state, sliced like the frames
+    bool full;              // the segments cover the whole strip
+    uint16_t opacity;       // 0..LED_BLEND_FULL
+    led_blend_mode_t blend;
+} animation_layer_t;
+
+static animation_layer_t layers[ANIMATION_MAX_LAYERS];
+static led_color_t *layer_scratch = NULL; // a transitioning segment is blended here before compositing
+
+_Static_assert(ANIMATION_MAX_LAYERS * ANIMATION_MAX_SEGMENTS <= RMT_LED_STRIP_MAX_RANGES,
+               "every segment may need a dimmed range");
+
+// When a single periodic segment is all that shows, one cycle of its frames
+// is packed into the cache and played back without rendering
+static animation_cache_t frame_cache;
+static animation_segment_t *cached_segment = NULL; // the segment the cache is for, if any
+static uint32_t cached_steps; // speed steps in the cached cycle
+static uint8_t cached_brightness;
+
+// Frame clock, wakes the render task at every deadline
+static void animation_frame_tick(void *arg)
+{
+    xTaskNotifyGive(animation_task_handle);
+}
+
+static void effect_start(animation_effect_t *effect, const animation_config_t *config, bool restart)
+{
+    if (restart || config->type != effect->config.type || config->seed != effect->config.seed) {
+        // a new effect or seed starts from the first frame, a tweak keeps the phase
+        effect->def = &animation_effects[config->type];
+        effect->step_us = 0;
+        effect->clock = (animation_clock_t){ 0 };
+        memset(effect->state, 0, effect->def->state_size);
+        memset(effect->span.led_state, 0, effect->span.num_leds * effect->def->led_state_size);
+        if (effect->def->init) {
+            effect->def->init(effect->state, config);
+        }
+    }
+    effect->config = *config;
+    // The table of a palette stays put, only its colors are rebuilt
+    const led_color_t *palette = led_palette_lut(config->palette);
+    effect->span.palette = effect->def->palette == LED_PALETTE_NONE ? NULL :
+                           palette ? palette : led_palette_lut(effect->def->palette);
+    effect->dirty = true;
+}
+
+// Advance the clock of an effect by the elapsed time, returns true if it
+// has to render
+static bool effect_advance(animation_effect_t *effect, int64_t elapsed_us)
+{
+    // Effects advance by elapsed time, one step per 'speed' ms, so their
+    // pace does not depend on the frame rate or on dropped frames
+    int64_t step_period_us = (effect->config.speed ? effect->config.speed : 1) * 1000LL;
+    animation_clock_t *clock = &effect->clock;
+    effect->step_us += elapsed_us << 16;
+    uint64_t phase = clock->phase + effect->step_us / step_period_us;
+    effect->step_us %= step_period_us;
+    clock->steps += (phase >> 16) - (clock->phase >> 16);
+    clock->phase = phase;
+    clock->time_us += elapsed_us;
+    return clock->steps > 0 || effect->dirty || effect->def->continuous;
+}
+
+// Advance an effect by the elapsed time and render it if it moved
+static bool effect_update(animation_effect_t *effect, int64_t elapsed_us)
+{
+    if (!effect_advance(effect, elapsed_us)) {
+        return false;
+    }
+    effect->def->render(effect->state, &effect->config, &effect->span, &effect->clock);
+    effect->clock.steps = 0;
+    effect->dirty = false;
+    return true;
+}
+
+// Pixel i switches to the new effect once amount passes its threshold, the
+// thresholds are a fixed scramble of the index so the pattern looks random
+static inline uint32_t dissolve_threshold(uint32_t i)
+{
+    return ((i * 2654435761u) >> 24) + 1;
+}
+
+static void transition_render(led_color_t *dst, const led_color_t *from, const led_color_t *to, uint32_t num_leds,
+                              animation_transition_t type, uint16_t amount)
+{
+    switch (type) {
+    case ANIMATION_TRANSITION_WIPE: {
+        // the new effect sweeps in from the start of the strip
+        uint32_t edge = (num_leds * amount) >> 8;
+        memcpy(dst, to, edge * sizeof(led_color_t));
+        memcpy(dst + edge, from + edge, (num_leds - edge) * sizeof(led_color_t));
+        break;
+    }
+    case ANIMATION_TRANSITION_DISSOLVE:
+        for (uint32_t i = 0; i < num_leds; i++) {
+            dst[i] = dissolve_threshold(i) <= amount ? to[i] : from[i];
+        }
+        break;
+    case ANIMATION_TRANSITION_FADE:
+    default:
+        led_blend_lerp(dst, from, to, num_leds, amount);
+        break;
+    }
+}
+
+static bool segment_visible(const animation_segment_t *segment)
+{
+    return segment->transitioning || segment->effects[segment->current].config.type != ANIMATION_NONE;
+}
 
-// Helper function for smooth sine wave
-static float smooth_sin(float x) {
-    return (sin(x) + 1.0f) / 2.0f;
+// A segment above the bottom layer fades in from nothing and out to nothing
+// through its opacity, an empty effect would cover the layers below in black
+static bool segment_fading(uint32_t layer, const animation_segment_t *segment)
+{
+    return layer > 0 && segment->transitioning &&
+           (segment->effects[0].config.type == ANIMATION_NONE || segment->effects[1].config.type == ANIMATION_NONE);
+}
+
+static bool layer_visible(const animation_layer_t *layer)
+{
+    if (layer->opacity == 0) {
+        return false;
+    }
+    for (uint32_t i = 0; i < layer->num_segments; i++) {
+        if (segment_visible(&layer->segments[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// An opaque normal layer that fills the strip hides everything below it
+static bool layer_covers(uint32_t index)
+{
+    const animation_layer_t *layer = &layers[index];
+    if (!layer->full || layer->blend != LED_BLEND_NORMAL || layer->opacity != LED_BLEND_FULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < layer->num_segments; i++) {
+        if (!segment_visible(&layer->segments[i]) || segment_fading(index, &layer->segments[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Map the span an effect rendered onto its segment: reverse it and mirror it
+// onto the second half. The segment brightness is applied when compositing.
+static void segment_finish(const animation_segment_t *segment, animation_effect_t *effect)
+{
+    led_color_t *pixels = effect->span.pixels;
+    uint32_t span = effect->span.num_leds;
+    uint32_t length = segment->config.length;
+    if (segment->config.reverse) {
+        for (uint32_t i = 0; i < span / 2; i++) {
+            led_color_t tmp = pixels[i];
+            pixels[i] = pixels[span - 1 - i];
+            pixels[span - 1 - i] = tmp;
+        }
+    }
+    if (segment->config.mirror) {
+        for (uint32_t i = 0; i < length - span; i++) {
+            pixels[length - 1 - i] = pixels[i];
+        }
+    }
+}
+
+// Whether no visible segment of another shown layer overlaps a segment
+static bool segment_alone(int bottom, uint32_t layer_index, const animation_segment_t *segment)
+{
+    uint32_t start = segment->config.start;
+    uint32_t end = start + segment->config.length;
+    for (int i = bottom; i < ANIMATION_MAX_LAYERS; i++) {
+        const animation_layer_t *layer = &layers[i];
+        for (uint32_t j = 0; (uint32_t)i != layer_index && layer->opacity > 0 && j < layer->num_segments; j++) {
+            const animation_segment_t *other = &layer->segments[j];
+            if (segment_visible(other) && other->config.start < end &&
+                start < other->config.start + other->config.length) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A dimmed segment with nothing composited over or under it is dimmed in the
+// output stage, after the gamma lookup, where no precision is lost. Returns
+// the ranges of those segments, sorted by start.
+static uint32_t segment_ranges(int bottom, led_strip_range_t *ranges)
+{
+    uint32_t count = 0;
+    for (int i = bottom; i < ANIMATION_MAX_LAYERS; i++) {
+        const animation_layer_t *layer = &layers[i];
+        for (uint32_t j = 0; layer->opacity > 0 && j < layer->num_segments; j++) {
+            const animation_segment_t *segment = &layer->segments[j];
+            if (segment->config.brightness == 255 || !segment_visible(segment) || !segment_alone(bottom, i, segment)) {
+                continue;
+            }
+            uint32_t k = count++;
+            for (; k > 0 && ranges[k - 1].start > segment->config.start; k--) {
+                ranges[k] = ranges[k - 1];
+            }
+            ranges[k] = (led_strip_range_t){
+                .start = segment->config.start,
+                .length = segment->config.length,
+                .brightness = segment->config.brightness,
+            };
+        }
+    }
+    return count;
+}
+
+// A dimmed segment that is blended with others has to be dimmed before, in
+// 8 bits, into its slice of the scratch frame
+static const led_color_t *segment_dim(const animation_segment_t *segment, const led_color_t *frame)
+{
+    const uint8_t *src = (const uint8_t *)frame;
+    uint8_t *dst = (uint8_t *)(layer_scratch + segment->config.start);
+    uint32_t scale = led_blend_amount(segment->config.brightness);
+    for (uint32_t i = 0; i < segment->config.length * sizeof(led_color_t); i++) {
+        dst[i] = (src[i] * scale + 0x80) >> 8;
+    }
+    return layer_scratch + segment->config.start;
+}
+
+static void segment_apply(animation_segment_t *segment, const animation_config_t *next, int64_t now_us)
+{
+    animation_effect_t *effect = &segment->effects[segment->current];
+    if (next->type != effect->config.type && next->transition != ANIMATION_TRANSITION_NONE && next->transition_ms > 0) {
+        // The running effect keeps going in the other slot and is blended
+        // out. A transition that is still running is cut short.
+        segment->current ^= 1;
+        effect_start(&segment->effects[segment->current], next, true);
+        segment->transitioning = true;
+        segment->transition_start_us = now_us;
+        segment->amount = 0;
+    } else {
+        effect_start(effect, next, false);
+    }
+}
+
+static void layer_apply(const animation_command_t *command, int64_t now_us)
+{
+    animation_layer_t *layer = &layers[command->layer];
+    uint32_t covered = 0;
+    for (uint32_t i = 0; i < command->num_segments; i++) {
+        animation_segment_t *segment = &layer->segments[i];
+        const animation_segment_config_t *config = &command->segments[i];
+        bool moved = i >= layer->num_segments || config->start != segment->config.start ||
+                     config->length != segment->config.length || config->reverse != segment->config.reverse ||
+                     config->mirror != segment->config.mirror;
+        segment->config = *config;
+        if (moved) {
+            // The old frames of the slot are not where the segment is now, so
+            // it starts over without a transition
+            uint32_t span = config->mirror ? (config->length + 1) / 2 : config->length;
+            for (int j = 0; j < 2; j++) {
+                segment->effects[j].span = (animation_span_t){
+                    .pixels = layer->frames[j] + config->start,
+                    .num_leds = span,
+                    .scratch = effect_scratch,
+                    .led_state = layer->led_states[j] + config->start * ANIMATION_EFFECT_LED_STATE_SIZE,
+                };
+            }
+            segment->current = 0;
+            segment->transitioning = false;
+            effect_start(&segment->effects[0], &config->animation, true);
+        } else {
+            segment_apply(segment, &config->animation, now_us);
+            // the brightness may have changed, the old effect renders again too
+            segment->effects[segment->current ^ 1].dirty = true;
+        }
+        covered += config->length;
+    }
+    layer->num_segments = command->num_segments;
+    layer->full = covered == led_strip_get_num_leds();
+    layer->opacity = led_blend_amount(command->opacity);
+    layer->blend = command->blend;
+}
+
+// Advance a segment by the elapsed time, returns true if its frame changed
+static bool segment_update(animation_segment_t *segment, int64_t now_us, int64_t elapsed_us)
+{
+    animation_effect_t *effect = &segment->effects[segment->current];
+    bool moved = effect_update(effect, elapsed_us);
+    if (moved) {
+        segment_finish(segment, effect);
+    }
+    if (!segment->transitioning) {
+        return moved;
+    }
+    animation_effect_t *old = &segment->effects[segment->current ^ 1];
+    if (effect_update(old, elapsed_us)) {
+        segment_finish(segment, old);
+    }
+    int64_t duration_us = effect->config.transition_ms * 1000LL;
+    int64_t progress_us = now_us - segment->transition_start_us;
+    segment->amount = progress_us >= duration_us ? LED_BLEND_FULL : progress_us * LED_BLEND_FULL / duration_us;
+    segment->transitioning = segment->amount < LED_BLEND_FULL;
+    return true;
+}
+
+// The frame a segment contributes and its opacity. A running transition is
+// blended into the segment's slice of the scratch frame.
+static const led_color_t *segment_frame(uint32_t layer, const animation_segment_t *segment, uint16_t *opacity)
+{
+    const animation_effect_t *effect = &segment->effects[segment->current];
+    const animation_effect_t *old = &segment->effects[segment->current ^ 1];
+    *opacity = layers[layer].opacity;
+    if (!segment->transitioning) {
+        return effect->span.pixels;
+    }
+    if (segment_fading(layer, segment)) {
+        if (effect->config.type == ANIMATION_NONE) {
+            *opacity = (*opacity * (LED_BLEND_FULL - segment->amount)) >> 8;
+            return old->span.pixels;
+        }
+        *opacity = (*opacity * segment->amount) >> 8;
+        return effect->span.pixels;
+    }
+    led_color_t *scratch = layer_scratch + segment->config.start;
+    transition_render(scratch, old->span.pixels, effect->span.pixels, segment->config.length, effect->config.transition,
+                      segment->amount);
+    return scratch;
+}
+
+// The only segment that shows, if its frames repeat and it is not in a
+// transition, so a cycle of its frames is a cycle of the whole strip
+static animation_segment_t *cacheable_segment(int bottom, uint32_t *layer_index)
+{
+    animation_segment_t *found = NULL;
+    for (int i = bottom; i < ANIMATION_MAX_LAYERS; i++) {
+        animation_layer_t *layer = &layers[i];
+        for (uint32_t j = 0; layer->opacity > 0 && j < layer->num_segments; j++) {
+            animation_segment_t *segment = &layer->segments[j];
+            if (!segment_visible(segment)) {
+                continue;
+            }
+            if (found || segment->transitioning || !segment->effects[segment->current].def->period) {
+                return NULL;
+            }
+            found = segment;
+            *layer_index = i;
+        }
+    }
+    return found;
+}
+
+// Frames in a cycle of steps of an effect. Stepped effects only change once a
+// step, continuous ones are sampled like the live frames, ANIMATION_TARGET_FPS
+// times over the steps * speed ms of the cycle.
+static uint32_t cycle_frames(const animation_effect_t *effect, uint32_t steps)
+{
+    if (!effect->def->continuous) {
+        return steps;
+    }
+    uint64_t step_ms = effect->config.speed ? effect->config.speed : 1;
+    uint64_t frames = (steps * step_ms * ANIMATION_TARGET_FPS + 500) / 1000;
+    return frames == 0 ? 1 : frames > UINT32_MAX ? UINT32_MAX : frames;
+}
+
+// Render the next few frames of the cached segment's cycle, flatten them as
+// the strip would show them and pack them into the cache
+static void cache_fill(uint32_t layer_index, animation_segment_t *segment)
+{
+    animation_effect_t *effect = &segment->effects[segment->current];
+    const animation_layer_t *layer = &layers[layer_index];
+    const uint32_t num_leds = led_strip_get_num_leds();
+    uint32_t index;
+    uint8_t *frame;
+    for (int i = 0; i < ANIMATION_FRAME_CACHE_FILL && (frame = animation_cache_next(&frame_cache, &index)); i++) {
+        // frame index of the cycle shows the effect this far into it
+        animation_clock_t clock = { .phase = ((uint64_t)cached_steps << 16) * index / frame_cache.period };
+        effect->def->render(effect->state, &effect->config, &effect->span, &clock);
+        segment_finish(segment, effect);
+        memset(layer_scratch, 0, num_leds * sizeof(led_color_t));
+        led_blend_layer(layer_scratch + segment->config.start, effect->span.pixels, segment->config.length,
+                        layer->blend, layer->opacity);
+        led_strip_pack(layer_scratch, frame);
+    }
+    // the span holds a cached step now, the live frame has to render again
+    effect->dirty = true;
+}
+
+// Send the cached frame of the current point in the cycle, returns false if
+// the cycle is not cached (yet)
+static bool cache_show(int64_t elapsed_us)
+{
+    if (!cached_segment || !animation_cache_ready(&frame_cache)) {
+        return false;
+    }
+    animation_effect_t *effect = &cached_segment->effects[cached_segment->current];
+    effect_advance(effect, elapsed_us);
+    effect->clock.steps = 0;
+    effect->dirty = true; // the span is stale once the cache is left
+    stats.frames_cached++;
+    uint8_t *frame;
+    if (led_strip_acquire_frame(&frame, -1) == ESP_OK) {
+        uint64_t cycle = (uint64_t)cached_steps << 16;
+        uint64_t index = effect->clock.phase % cycle * frame_cache.period / cycle;
+        memcpy(frame, animation_cache_frame(&frame_cache, index), frame_cache.frame_size);
+        led_strip_submit_frame();
+    }
+    return true;
 }
 
 // Animation task function
 static void animation_task(void *pvParameters)
 {
-    uint32_t hue = 0;
-    float brightness = 1.0f;
-    bool increasing = true;
-    uint8_t position = 0;
-    float time = 0.0f;  // For time-based animations
+    led_color_t *pixels = led_strip_get_pixels();
+    const uint32_t num_leds = led_strip_get_num_leds();
+    int64_t last_frame_us = 0;
 
     while (1) {
-        switch (current_config.type) {
-            case ANIMATION_RAINBOW:
-                // Rainbow animation - cycle through all hues
-                for (int i = 0; i < NUM_LEDS; i++) {
-                    uint32_t led_hue = (hue + (i * 360 / NUM_LEDS)) % 360;
-                    uint32_t r, g, b;
-                    led_strip_hsv2rgb(led_hue, 100, current_config.brightness, &r, &g, &b);
-                    led_buffer[i * 3] = g;
-                    led_buffer[i * 3 + 1] = r;
-                    led_buffer[i * 3 + 2] = b;
+        animation_command_t command;
+        bool idle = true;
+        for (int i = 0; i < ANIMATION_MAX_LAYERS; i++) {
+            for (uint32_t j = 0; j < layers[i].num_segments; j++) {
+                if (segment_visible(&layers[i].segments[j])) {
+                    idle = false;
                 }
-                hue = (hue + 1) % 360;
-                break;
-
-            case ANIMATION_SOLID_COLOR:
-                // Set all LEDs to the same color
-                for (int i = 0; i < NUM_LEDS; i++) {
-                    led_buffer[i * 3] = current_config.g;     // Green
-                    led_buffer[i * 3 + 1] = current_config.r; // Red
-                    led_buffer[i * 3 + 2] = current_config.b; // Blue
-                }
-                break;
-
-            case ANIMATION_BREATHING:
-                // Log values periodically (every 50 frames to avoid spam)
-                // Breathing animation - fade in and out
-                if (increasing) {
-                    brightness += 0.01f;
-                    if (brightness >= 1.0f) {
-                        brightness = 1.0f;
-                        increasing = false;
-                    }
-                } else {
-                    brightness -= 0.01f;
-                    if (brightness <= 0.0f) {
-                        brightness = 0.0f;
-                        increasing = true;
-                    }
-                }
-                for (int i = 0; i < NUM_LEDS; i++) {
-                    led_buffer[i * 3] = current_config.g * brightness;
-                    led_buffer[i * 3 + 1] = current_config.r * brightness;
-                    led_buffer[i * 3 + 2] = current_config.b * brightness;
-                }
-                break;
-
-            case ANIMATION_CHASE:
-                // Chase animation - moving dot
-                memset(led_buffer, 0, sizeof(led_buffer));
-                led_buffer[position * 3] = current_config.g;
-                led_buffer[position * 3 + 1] = current_config.r;
-                led_buffer[position * 3 + 2] = current_config.b;
-                position = (position + 1) % NUM_LEDS;
-                break;
-
-            case ANIMATION_FIRE:
-                // Fire animation - flickering orange/yellow
-                for (int i = 0; i < NUM_LEDS; i++) {
-                    uint8_t flicker = rand() % 55;
-                    uint8_t r = 255;
-                    uint8_t g = 50 + flicker;
-                    uint8_t b = 0;
-                    led_buffer[i * 3] = g;
-                    led_buffer[i * 3 + 1] = r;
-                    led_buffer[i * 3 + 2] = b;
-                }
-                break;
-
-            case ANIMATION_LIGHTNING:
-                // Lightning animation - random bright flashes
-                if (rand() % 100 < 5) { // 5% chance of a flash
-                    // Bright flash
-                    for (int i = 0; i < NUM_LEDS; i++) {
-                        uint8_t intensity = 200 + (rand() % 55); // Random intensity between 200-255
-                        led_buffer[i * 3] = intensity;     // G
-                        led_buffer[i * 3 + 1] = intensity; // R
-                        led_buffer[i * 3 + 2] = 255;       // B (more blue for lightning effect)
-                    }
-                    // Short delay for the flash
-                    vTaskDelay(pdMS_TO_TICKS(50));
-                } else {
-                    // Fade out
-                    for (int i = 0; i < NUM_LEDS; i++) {
-                        led_buffer[i * 3] = 0;     // G
-                        led_buffer[i * 3 + 1] = 0; // R
-                        led_buffer[i * 3 + 2] = 0; // B
-                    }
-                }
-                break;
-
-            case ANIMATION_OCEAN:
-                // Ocean wave animation - gentle blue waves
-                for (int i = 0; i < NUM_LEDS; i++) {
-                    // Create a wave pattern with multiple frequencies
-                    float wave1 = smooth_sin(time + i * 0.2f) * 0.5f;
-                    float wave2 = smooth_sin(time * 0.7f + i * 0.1f) * 0.3f;
-                    float wave3 = smooth_sin(time * 0.3f + i * 0.05f) * 0.2f;
-                    float intensity = (wave1 + wave2 + wave3) * 0.7f;
-                    
-                    // Ocean blue color with varying intensity
-                    led_buffer[i * 3] = 50 + (intensity * 50);     // G
-                    led_buffer[i * 3 + 1] = 0;                     // R
-                    led_buffer[i * 3 + 2] = 100 + (intensity * 100); // B
+            }
+        }
+        bool changed = false;
+        if (idle) {
+            // Nothing to animate: stop the frame clock and sleep until the next change
+            esp_timer_stop(frame_timer);
+            xQueuePeek(animation_queue, &command, portMAX_DELAY);
+            ulTaskNotifyTake(pdTRUE, 0); // drop a tick that raced with the stop
+            esp_timer_start_periodic(frame_timer, 1000000 / ANIMATION_TARGET_FPS);
+            last_frame_us = esp_timer_get_time();
+        } else {
+            // Frames run on absolute deadlines. More than one pending tick means
+            // rendering overran; those frames are dropped, not made up for.
+            uint32_t ticks = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            if (ticks > 1) {
+                stats.frames_dropped += ticks - 1;
+            }
+        }
+        stats.frames++;
+
+        int64_t now_us = esp_timer_get_time();
+        int64_t elapsed_us = now_us - last_frame_us;
+        last_frame_us = now_us;
+
+        // Configuration changes are applied between frames
+        while (xQueueReceive(animation_queue, &command, 0) == pdTRUE) {
+            layer_apply(&command, now_us);
+            changed = true;
+        }
+
+        // An uploaded palette is compiled here, once, and every effect
+        // renders again in case it uses it
+        if (led_palette_update()) {
+            for (int i = 0; i < ANIMATION_MAX_LAYERS; i++) {
+                for (uint32_t j = 0; j < layers[i].num_segments; j++) {
+                    layers[i].segments[j].effects[0].dirty = true;
+                    layers[i].segments[j].effects[1].dirty = true;
                 }
-                time += 0.05f; // Slow wave movement
-                break;
-
-            case ANIMATION_AURORA:
-                // Aurora borealis effect - flowing green/purple waves
-                for (int i = 0; i < NUM_LEDS; i++) {
-                    // Create flowing aurora patterns
-                    float pos = (float)i / NUM_LEDS;
-                    float wave1 = smooth_sin(time + pos * 3.0f) * 0.5f;
-                    float wave2 = smooth_sin(time * 0.7f + pos * 2.0f) * 0.3f;
-                    float wave3 = smooth_sin(time * 0.3f + pos * 1.0f) * 0.2f;
-                    float intensity = (wave1 + wave2 + wave3) * 0.8f;
-                    
-                    // Aurora colors (green and purple) with intensity modulation
-                    float green = (0.7f + (wave1 * 0.3f)) * intensity;
-                    float blue = (0.5f + (wave2 * 0.5f)) * intensity;
-                    float red = (0.3f + (wave3 * 0.7f)) * intensity;
-                    
-                    led_buffer[i * 3] = green * 255;     // G
-                    led_buffer[i * 3 + 1] = red * 255;   // R
-                    led_buffer[i * 3 + 2] = blue * 255;  // B
+            }
+            changed = true;
+        }
+
+        // Layers under the topmost opaque normal layer are hidden, neither
+        // they nor transparent layers and empty segments are rendered
+        int bottom = ANIMATION_MAX_LAYERS - 1;
+        while (bottom > 0 && !layer_covers(bottom)) {
+            bottom--;
+        }
+
+        led_strip_range_t ranges[ANIMATION_MAX_LAYERS * ANIMATION_MAX_SEGMENTS];
+        led_strip_set_ranges(ranges, segment_ranges(bottom, ranges));
+
+        // Any change starts the cache over, and so does a brightness change,
+        // since the cached frames went through the output stage
+        uint32_t cache_layer = 0;
+        animation_segment_t *cacheable = cacheable_segment(bottom, &cache_layer);
+        uint8_t brightness = led_strip_get_brightness();
+        if (changed || cacheable != cached_segment || brightness != cached_brightness) {
+            const animation_effect_t *effect = cacheable ? &cacheable->effects[cacheable->current] : NULL;
+            cached_steps = effect ? effect->def->period(&effect->config, effect->span.num_leds) : 0;
+            animation_cache_start(&frame_cache, cached_steps ? cycle_frames(effect, cached_steps) : 0);
+            cached_segment = cacheable;
+            cached_brightness = brightness;
+        }
+        if (cache_show(elapsed_us)) {
+            continue;
+        }
+        if (cached_segment && frame_cache.period > 0) {
+            cache_fill(cache_layer, cached_segment);
+        }
+
+        for (int i = bottom; i < ANIMATION_MAX_LAYERS; i++) {
+            animation_layer_t *layer = &layers[i];
+            for (uint32_t j = 0; layer->opacity > 0 && j < layer->num_segments; j++) {
+                animation_segment_t *segment = &layer->segments[j];
+                if (segment_visible(segment) && segment_update(segment, now_us, elapsed_us)) {
+                    changed = true;
                 }
-                time += 0.03f; // Slow aurora movement
-                break;
+            }
+        }
 
-            case ANIMATION_NONE:
-            default:
-                // No animation - keep LEDs off
-                memset(led_buffer, 0, sizeof(led_buffer));
-                break;
+        // The framebuffer is shared with led_strip_set() callers, it is only
+        // drawn while this task holds the back buffer and with it the frame
+        // lock. led_strip_show() packs the same buffer and releases both.
+        uint8_t *frame;
+        if (led_strip_acquire_frame(&frame, -1) != ESP_OK) {
+            continue;
         }
 
-        // Apply brightness
-        for (int i = 0; i < NUM_LEDS * 3; i++) {
-            led_buffer[i] = (led_buffer[i] * current_config.brightness) / 255;
+        // Flatten the visible segments, only when one of them changed
+        if (changed) {
+            if (!layer_covers(bottom)) {
+                memset(pixels, 0, num_leds * sizeof(led_color_t));
+            }
+            for (int i = bottom; i < ANIMATION_MAX_LAYERS; i++) {
+                animation_layer_t *layer = &layers[i];
+                for (uint32_t j = 0; layer->opacity > 0 && j < layer->num_segments; j++) {
+                    const animation_segment_t *segment = &layer->segments[j];
+                    if (segment_visible(segment)) {
+                        uint16_t opacity;
+                        const led_color_t *frame = segment_frame(i, segment, &opacity);
+                        if (segment->config.brightness < 255 && !segment_alone(bottom, i, segment)) {
+                            frame = segment_dim(segment, frame);
+                        }
+                        led_blend_layer(pixels + segment->config.start, frame, segment->config.length, layer->blend,
+                                        opacity);
+                    }
+                }
+            }
         }
 
-        // Update LEDs
-        led_strip_set(led_buffer);
+        // Update LEDs, packing the frame for each output's wire format. Frames
+        // where nothing moved are shown too, the dither of a still scene runs
+        // on for a moment and then settles into skipped frames.
+        led_strip_show();
+    }
+}
 
-        // Wait for next frame
-        vTaskDelay(pdMS_TO_TICKS(current_config.speed));
+static void animation_free(void)
+{
+    animation_cache_free(&frame_cache);
+    free(effect_scratch);
+    effect_scratch = NULL;
+    free(layer_scratch);
+    layer_scratch = NULL;
+    for (int i = 0; i < ANIMATION_MAX_LAYERS; i++) {
+        for (int j = 0; j < 2; j++) {
+            free(layers[i].frames[j]);
+            layers[i].frames[j] = NULL;
+            free(layers[i].led_states[j]);
+            layers[i].led_states[j] = NULL;
+        }
     }
 }
 
 esp_err_t animation_init(void)
 {
-    animation_queue = xQueueCreate(1, sizeof(animation_config_t));
-    if (!animation_queue) {
-        ESP_LOGE(TAG, "Failed to create animation queue");
+    if (animation_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Allocated once, switching effects never touches the heap
+    uint32_t num_leds = led_strip_get_num_leds();
+    bool allocated = true;
+    effect_scratch = calloc(num_leds, sizeof(uint16_t));
+    layer_scratch = calloc(num_leds, sizeof(led_color_t));
+    allocated = effect_scratch && layer_scratch;
+    for (int i = 0; i < ANIMATION_MAX_LAYERS; i++) {
+        for (int j = 0; j < 2; j++) {
+            layers[i].frames[j] = calloc(num_leds, sizeof(led_color_t));
+            layers[i].led_states[j] = calloc(num_leds, ANIMATION_EFFECT_LED_STATE_SIZE);
+            allocated = allocated && layers[i].frames[j] && layers[i].led_states[j];
+        }
+    }
+    if (!allocated) {
+        ESP_LOGE(TAG, "Failed to allocate effect frames");
+        animation_free();
         return ESP_ERR_NO_MEM;
     }
 
-    // Initialize with no animation
-    current_config.type = ANIMATION_NONE;
-    current_config.speed = 50;
-    current_config.brightness = 128;  // Default to 50% brightness in 0-255 range
-    current_config.r = 255;
-    current_config.g = 255;
-    current_config.b = 255;
+    // Optional, without it every animation renders live
+    animation_cache_init(&frame_cache, led_strip_get_frame_size());
+
+    esp_timer_create_args_t timer_args = {
+        .callback = animation_frame_tick,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "led_frame",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &frame_timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create frame timer");
+        animation_free();
+        return ret;
+    }
 
+    // The task drains every change at its next frame boundary
+    animation_queue = xQueueCreateStatic(ANIMATION_QUEUE_LENGTH, sizeof(animation_command_t), animation_queue_storage,
+                                         &animation_queue_struct);
+
+    // The built-in palettes are compiled before any effect uses them
+    led_palette_update();
+
+    // Initialize with no animation on any layer, each one a single segment
+    // over the whole strip
+    animation_config_t config = {
+        .type = ANIMATION_NONE,
+        .speed = 50,
+        .brightness = 128,  // Default to 50% brightness in 0-255 range
+        .r = 255,
+        .g = 255,
+        .b = 255,
+        .transition = ANIMATION_TRANSITION_NONE,
+    };
+    for (int i = 0; i < ANIMATION_MAX_LAYERS; i++) {
+        requested[i] = (animation_command_t){
+            .layer = i,
+            .opacity = 255,
+            .blend = LED_BLEND_NORMAL,
+            .num_segments = 1,
+            .segments[0] = { .start = 0, .length = num_leds, .brightness = 255, .animation = config },
+        };
+        layer_apply(&requested[i], 0);
+    }
+
+    animation_task_handle = xTaskCreateStatic(animation_task, "led_animation", ANIMATION_TASK_STACK_SIZE, NULL,
+                                              ANIMATION_TASK_PRIORITY, animation_task_stack, &animation_task_tcb);
     return ESP_OK;
 }
 
+static bool animation_config_valid(const animation_config_t *config)
+{
+    return config->type < ANIMATION_MAX && config->transition < ANIMATION_TRANSITION_MAX;
+}
+
+// Hand a layer configuration to the render task, which applies it at its
+// next frame boundary. The wait only runs out if the task is stuck.
+static esp_err_t animation_send(const animation_command_t *command)
+{
+    if (xQueueSend(animation_queue, command, pdMS_TO_TICKS(100)) != pdTRUE) {
+        ESP_LOGW(TAG, "Render task is not taking changes");
+        return ESP_ERR_TIMEOUT;
+    }
+    // Only a queued command counts as requested, one that timed out never runs
+    requested[command->layer] = *command;
+    return ESP_OK;
+}
+
+esp_err_t animation_set_layer(uint32_t layer, const animation_layer_config_t *config)
+{
+    if (layer >= ANIMATION_MAX_LAYERS || !config || !animation_config_valid(&config->animation) ||
+        config->blend >= LED_BLEND_MODE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!animation_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ESP_LOGI(TAG, "Layer %lu: animation type %d, opacity %d, blend %s", (unsigned long)layer, config->animation.type,
+             config->opacity, led_blend_mode_name(config->blend));
+    animation_command_t command = {
+        .layer = layer,
+        .opacity = config->opacity,
+        .blend = config->blend,
+        .num_segments = 1,
+        .segments[0] = { .start = 0, .length = led_strip_get_num_leds(), .brightness = 255,
+                         .animation = config->animation },
+    };
+    return animation_send(&command);
+}
+
+esp_err_t animation_set_segments(uint32_t layer, const animation_segment_config_t *segments, uint32_t count)
+{
+    if (layer >= ANIMATION_MAX_LAYERS || count > ANIMATION_MAX_SEGMENTS || (count > 0 && !segments)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!animation_task_handle) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint32_t num_leds = led_strip_get_num_leds();
+    for (uint32_t i = 0; i < count; i++) {
+        const animation_segment_config_t *segment = &segments[i];
+        if (segment->length == 0 || segment->start >= num_leds || segment->length > num_leds - segment->start ||
+            !animation_config_valid(&segment->animation)) {
+            ESP_LOGE(TAG, "Invalid segment %lu", (unsigned long)i);
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (uint32_t j = 0; j < i; j++) {
+            if (segment->start < segments[j].start + segments[j].length &&
+                segments[j].start < segment->start + segment->length) {
+                ESP_LOGE(TAG, "Segment %lu overlaps segment %lu", (unsigned long)i, (unsigned long)j);
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
+    }
+
+    ESP_LOGI(TAG, "Layer %lu: %lu segments", (unsigned long)layer, (unsigned long)count);
+    animation_command_t command = requested[layer];
+    command.num_segments = count;
+    memcpy(command.segments, segments, count * sizeof(animation_segment_config_t));
+    return animation_send(&command);
+}
+
 esp_err_t animation_start(const animation_config_t *config)
 {
-    if (!config || config->type >= ANIMATION_MAX) {
+    if (!config || !animation_config_valid(config)) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    // Stop current animation if running
-    if (animation_task_handle) {
-        vTaskDelete(animation_task_handle);
-        animation_task_handle = NULL;
+    if (!animation_task_handle) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // Update configuration
-    memcpy(&current_config, config, sizeof(animation_config_t));
-    
     // Log the RGB values
     ESP_LOGI(TAG, "Starting animation type %d with RGB: (%d, %d, %d), brightness: %d, speed: %d",
-             current_config.type, current_config.r, current_config.g, current_config.b,
-             current_config.brightness, current_config.speed);
+             config->type, config->r, config->g, config->b,
+             config->brightness, config->speed);
 
-    // Start new animation task
-    BaseType_t ret = xTaskCreate(animation_task, "led_animation", 4096, NULL, 5, &animation_task_handle);
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create animation task");
-        return ESP_ERR_NO_MEM;
-    }
+    // Brightness is applied by the output stage, effects render at full scale
+    led_strip_set_brightness(config->brightness > 255 ? 255 : config->brightness);
 
-    return ESP_OK;
+    animation_layer_config_t layer_config = { .animation = *config, .opacity = 255, .blend = LED_BLEND_NORMAL };
+    return animation_set_layer(0, &layer_config);
 }
 
 esp_err_t animation_stop(void)
 {
-    if (animation_task_handle) {
-        vTaskDelete(animation_task_handle);
-        animation_task_handle = NULL;
+    if (!animation_task_handle) {
+        return ESP_ERR_INVALID_STATE;
     }
 
-    // Turn off LEDs
-    memset(led_buffer, 0, sizeof(led_buffer));
-    led_strip_set(led_buffer);
+    // The render task turns the LEDs off and then idles until the next start
+    for (int i = 0; i < ANIMATION_MAX_LAYERS; i++) {
+        animation_command_t command = requested[i];
+        for (uint32_t j = 0; j < command.num_segments; j++) {
+            command.segments[j].animation.type = ANIMATION_NONE;
+        }
+        esp_err_t ret = animation_send(&command);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    return ESP_OK;
+}
+
+static const char *const transition_names[ANIMATION_TRANSITION_MAX] = {
+    [ANIMATION_TRANSITION_NONE] = "none",
+    [ANIMATION_TRANSITION_FADE] = "fade",
+    [ANIMATION_TRANSITION_WIPE] = "wipe",
+    [ANIMATION_TRANSITION_DISSOLVE] = "dissolve",
+};
 
-    current_config.type = ANIMATION_NONE;
+const char *animation_transition_name(animation_transition_t transition)
+{
+    return transition < ANIMATION_TRANSITION_MAX ? transition_names[transition] : NULL;
+}
+
+animation_transition_t animation_transition_from_name(const char *name)
+{
+    for (int i = 0; i < ANIMATION_TRANSITION_MAX; i++) {
+        if (name && strcmp(name, transition_names[i]) == 0) {
+            return i;
+        }
+    }
+    return ANIMATION_TRANSITION_MAX;
+}
+
+esp_err_t animation_get_stats(animation_stats_t *out)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = stats;
     return ESP_OK;
 }
 
@@ -248,6 +849,34 @@ esp_err_t animation_get_config(animation_config_t *config)
         return ESP_ERR_INVALID_ARG;
     }
 
-    memcpy(config, &current_config, sizeof(animation_config_t));
+    animation_layer_config_t layer;
+    animation_get_layer(0, &layer);
+    memcpy(config, &layer.animation, sizeof(animation_config_t));
+    return ESP_OK;
+}
+
+esp_err_t animation_get_layer(uint32_t layer, animation_layer_config_t *config)
+{
+    if (layer >= ANIMATION_MAX_LAYERS || !config) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // An empty segment table reads as no animation
+    const animation_command_t *command = &requested[layer];
+    config->animation = command->num_segments > 0 ? command->segments[0].animation :
+                        (animation_config_t){ .type = ANIMATION_NONE };
+    config->opacity = command->opacity;
+    config->blend = command->blend;
     return ESP_OK;
-} 
\ No newline at end of file
+}
+
+esp_err_t animation_get_segments(uint32_t layer, animation_segment_config_t *segments, uint32_t *count)
+{
+    if (layer >= ANIMATION_MAX_LAYERS || !segments || !count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *count = requested[layer].num_segments;
+    memcpy(segments, requested[layer].segments, *count * sizeof(animation_segment_config_t));
+    return ESP_OK;
+}
@@ -0,0 +1,89 @@
+#include <string.h>
+#include "ws2812_blend.h"
+
+static const char *const mode_names[LED_BLEND_MODE_MAX] = {
+    [LED_BLEND_NORMAL] = "normal",
+    [LED_BLEND_ADD] = "add",
+    [LED_BLEND_MULTIPLY] = "multiply",
+    [LED_BLEND_SCREEN] = "screen",
+    [LED_BLEND_MAX] = "max",
+};
+
+void led_blend_lerp(led_color_t *dst, const led_color_t *from, const led_color_t *to, size_t count, uint16_t amount)
+{
+    // Plain bytes, led_color_t is four uint8_t channels without padding
+    const uint8_t *a = (const uint8_t *)from;
+    const uint8_t *b = (const uint8_t *)to;
+    uint8_t *d = (uint8_t *)dst;
+    uint32_t keep = LED_BLEND_FULL - amount;
+    for (size_t i = 0; i < count * sizeof(led_color_t); i++) {
+        d[i] = (a[i] * keep + b[i] * amount) >> 8;
+    }
+}
+
+// One loop per blend mode: MODE combines the lower byte a with the layer byte
+// b, the result is then lerped in by the opacity like led_blend_lerp()
+#define LED_DEFINE_BLEND(name, MODE)                                                        \
+    static void led_blend_##name(uint8_t *d, const uint8_t *s, size_t n, uint32_t amount)  \
+    {                                                                                       \
+        uint32_t keep = LED_BLEND_FULL - amount;                                            \
+        for (size_t i = 0; i < n; i++) {                                                    \
+            uint32_t a = d[i];                                                              \
+            uint32_t b = s[i];                                                              \
+            d[i] = (a * keep + (MODE) * amount) >> 8;                                       \
+        }                                                                                   \
+    }
+
+LED_DEFINE_BLEND(normal, b)
+LED_DEFINE_BLEND(add, a + b > 255 ? 255 : a + b)
+// a * b / 255 without the division, exact at 0 and 255
+LED_DEFINE_BLEND(multiply, (a * (b + 1)) >> 8)
+LED_DEFINE_BLEND(screen, 255 - (((255 - a) * (256 - b)) >> 8))
+LED_DEFINE_BLEND(max, a > b ? a : b)
+
+void led_blend_layer(led_color_t *dst, const led_color_t *src, size_t count, led_blend_mode_t mode, uint16_t opacity)
+{
+    uint8_t *d = (uint8_t *)dst;
+    const uint8_t *s = (const uint8_t *)src;
+    size_t n = count * sizeof(led_color_t);
+    if (opacity == 0) {
+        return;
+    }
+    switch (mode) {
+    case LED_BLEND_ADD:
+        led_blend_add(d, s, n, opacity);
+        break;
+    case LED_BLEND_MULTIPLY:
+        led_blend_multiply(d, s, n, opacity);
+        break;
+    case LED_BLEND_SCREEN:
+        led_blend_screen(d, s, n, opacity);
+        break;
+    case LED_BLEND_MAX:
+        led_blend_max(d, s, n, opacity);
+        break;
+    case LED_BLEND_NORMAL:
+    default:
+        if (opacity >= LED_BLEND_FULL) {
+            memcpy(d, s, n);
+        } else {
+            led_blend_normal(d, s, n, opacity);
+        }
+        break;
+    }
+}
+
+const char *led_blend_mode_name(led_blend_mode_t mode)
+{
+    return mode < LED_BLEND_MODE_MAX ? mode_names[mode] : NULL;
+}
+
+led_blend_mode_t led_blend_mode_from_name(const char *name)
+{
+    for (int i = 0; i < LED_BLEND_MODE_MAX; i++) {
+        if (name && strcmp(name, mode_names[i]) == 0) {
+            return i;
+        }
+    }
+    return LED_BLEND_MODE_MAX;
+}
@@ -1,33 +1,79 @@
 #include <string.h>
 #include "esp_check.h"
 #include "ws2812_control.h"
-#include "driver/rmt_tx.h"
+#include "ws2812_output.h"
+#include "ws2812_spi_encode.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "nvs.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "freertos/semphr.h"
 
-static const char *TAG = "led_encoder";
+static const char *TAG = "led_strip";
 
 typedef struct {
-    rmt_encoder_t base;
-    rmt_encoder_t *bytes_encoder;
-    rmt_encoder_t *copy_encoder;
-    int state;
-    rmt_symbol_word_t reset_code;
-} rmt_led_strip_encoder_t;
+    led_output_t *backend;
+    led_pixel_packer_t pack;
+    uint32_t first_led;        // first framebuffer pixel of this output's segment
+    uint32_t num_leds;
+    size_t offset;             // first byte of this output's segment in a frame
+    size_t size;               // segment size in bytes
+    size_t pixel_bytes;        // wire bytes per pixel
+    uint8_t inflight[RMT_LED_STRIP_FRAME_BUFFERS]; // frames queued on the output, oldest at inflight_head
+    uint8_t inflight_head;     // advanced by the ISR only
+    uint8_t inflight_tail;     // advanced by the submitting task only
+} led_strip_output_t;
 
-static rmt_channel_handle_t led_chan = NULL;
-static rmt_encoder_handle_t led_encoder = NULL;
+static led_strip_output_t outputs[RMT_LED_STRIP_MAX_OUTPUTS];
+static uint32_t num_outputs = 0;
+
+// Frame buffers are handed out round-robin. A frame is free again once every
+// output has sent its segment of it; since each channel completes in
+// submission order, the count of free_frames always covers the oldest
+// submitted buffers, and back_frame is the oldest of them.
+static uint8_t *frame_buffers[RMT_LED_STRIP_FRAME_BUFFERS];
+static uint8_t *frame_memory = NULL;
+static size_t frame_size = 0;
+static led_color_t *pixels = NULL;
+static led_color_t *dither = NULL; // dither error of every framebuffer pixel
+static led_pixel_lut_t gamma_lut; // output stage at full brightness
+static led_pixel_lut_t lut;       // gamma_lut scaled by lut_brightness
+static volatile uint8_t brightness = 255;
+static uint8_t lut_brightness;
+static led_strip_range_t ranges[RMT_LED_STRIP_MAX_RANGES]; // dimmed in the output stage
+static uint32_t num_ranges;
+static uint32_t shown_hash;       // of the framebuffer and brightness last shown
+static uint32_t settled_frames;   // frames shown since either of them changed
+static uint32_t num_leds = 0;
+static SemaphoreHandle_t free_frames = NULL;
+// Held from led_strip_acquire_frame() to led_strip_submit_frame(), so the
+// render task and a direct led_strip_set() never fill the same back buffer
+static SemaphoreHandle_t frame_lock = NULL;
+static uint32_t pending_outputs[RMT_LED_STRIP_FRAME_BUFFERS];
+static portMUX_TYPE pending_lock = portMUX_INITIALIZER_UNLOCKED;
+static int back_frame = 0;
+static bool back_frame_acquired = false;
+
+// The frame submitted last is the one before back_frame and stays untouched
+// until back_frame has been submitted, so it can be compared byte by byte
+static bool last_frame_valid = false;
+static int64_t last_frame_time_us = 0;
+static led_strip_stats_t stats;
 
 #define RMT_LED_STRIP_RESOLUTION_HZ 10000000 // 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
 #define RMT_LED_STRIP_GPIO_NUM      17
 
-#define EXAMPLE_CHASE_SPEED_MS      10
-
 void led_strip_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t *g, uint32_t *b)
 {
-    h %= HSV_HUE_MAX; // h -> [0,360]
-    uint32_t rgb_max = v * HSV_RGB_MAX;
-    uint32_t rgb_min = rgb_max * (HSV_SATURATION_MAX - s) / HSV_RGB_MIN_DIVISOR;
+    // Standard spectrum in six sections, in integers so full value is 255
+    h %= 360;
+    s = s > 100 ? 100 : s;
+    v = v > 100 ? 100 : v;
+    uint32_t rgb_max = v * 255 / 100;
+    uint32_t rgb_min = rgb_max * (100 - s) / 100;
 
     uint32_t i = h / 60;
     uint32_t diff = h % 60;
@@ -69,181 +115,635 @@ void led_strip_hsv2rgb(uint32_t h, uint32_t s, uint32_t v, uint32_t *r, uint32_t
     }
 }
 
-static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+static inline TickType_t timeout_to_ticks(int timeout_ms)
 {
-    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
-    rmt_encoder_handle_t bytes_encoder = led_encoder->bytes_encoder;
-    rmt_encoder_handle_t copy_encoder = led_encoder->copy_encoder;
-    rmt_encode_state_t session_state = RMT_ENCODING_RESET;
-    rmt_encode_state_t state = RMT_ENCODING_RESET;
-    size_t encoded_symbols = 0;
-    switch (led_encoder->state) {
-    case 0: // send RGB data
-        encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
-        if (session_state & RMT_ENCODING_COMPLETE) {
-            led_encoder->state = 1; // switch to next state when current encoding session finished
-        }
-        if (session_state & RMT_ENCODING_MEM_FULL) {
-            state |= RMT_ENCODING_MEM_FULL;
-            goto out; // yield if there's no free space for encoding artifacts
+    return timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+}
+
+static bool IRAM_ATTR led_strip_output_done(void *user_ctx)
+{
+    led_strip_output_t *output = user_ctx;
+    uint8_t frame = output->inflight[output->inflight_head];
+    output->inflight_head = (output->inflight_head + 1) % RMT_LED_STRIP_FRAME_BUFFERS;
+
+    portENTER_CRITICAL_ISR(&pending_lock);
+    bool frame_sent = --pending_outputs[frame] == 0;
+    portEXIT_CRITICAL_ISR(&pending_lock);
+
+    BaseType_t task_woken = pdFALSE;
+    if (frame_sent) {
+        // the last output finished this frame, its buffer can be reused
+        xSemaphoreGiveFromISR(free_frames, &task_woken);
+    }
+    return task_woken == pdTRUE;
+}
+
+esp_err_t led_strip_acquire_frame(uint8_t **frame, int timeout_ms)
+{
+    if (!frame) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!num_outputs || !free_frames) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // A second call before the submit already owns the buffer
+    bool owned = xSemaphoreGetMutexHolder(frame_lock) == xTaskGetCurrentTaskHandle();
+    if (!owned && xSemaphoreTake(frame_lock, timeout_to_ticks(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (!back_frame_acquired) {
+        if (xSemaphoreTake(free_frames, timeout_to_ticks(timeout_ms)) != pdTRUE) {
+            if (!owned) {
+                xSemaphoreGive(frame_lock);
+            }
+            return ESP_ERR_TIMEOUT;
         }
-    // fall-through
-    case 1: // send reset code
-        encoded_symbols += copy_encoder->encode(copy_encoder, channel, &led_encoder->reset_code,
-                                                sizeof(led_encoder->reset_code), &session_state);
-        if (session_state & RMT_ENCODING_COMPLETE) {
-            led_encoder->state = RMT_ENCODING_RESET; // back to the initial encoding session
-            state |= RMT_ENCODING_COMPLETE;
+        back_frame_acquired = true;
+    }
+
+    *frame = frame_buffers[back_frame];
+    return ESP_OK;
+}
+
+static bool led_strip_frame_unchanged(int64_t now_us)
+{
+    if (RMT_LED_STRIP_FRAME_BUFFERS < 2 || !last_frame_valid) {
+        return false;
+    }
+    int last_frame = (back_frame + RMT_LED_STRIP_FRAME_BUFFERS - 1) % RMT_LED_STRIP_FRAME_BUFFERS;
+    if (memcmp(frame_buffers[back_frame], frame_buffers[last_frame], frame_size) != 0) {
+        return false;
+    }
+    if (RMT_LED_STRIP_KEEPALIVE_MS > 0 && now_us - last_frame_time_us >= RMT_LED_STRIP_KEEPALIVE_MS * 1000LL) {
+        stats.keepalives++;
+        return false;
+    }
+    return true;
+}
+
+static esp_err_t led_strip_submit_locked(void)
+{
+    // Most frames are static, skipping them saves the encoder work and the
+    // interrupt load of a transmission. memcmp stops at the first difference.
+    int64_t now_us = esp_timer_get_time();
+    if (led_strip_frame_unchanged(now_us)) {
+        stats.frames_skipped++;
+        return ESP_OK;
+    }
+
+    portENTER_CRITICAL(&pending_lock);
+    pending_outputs[back_frame] = num_outputs;
+    portEXIT_CRITICAL(&pending_lock);
+
+    // Start every output back to back so they all drain in parallel and the
+    // frame takes as long as the longest segment. An RMT sync manager would
+    // align them to the tick but needs an rmt_sync_reset() with all channels
+    // idle, which would stop frames from queueing behind each other.
+    esp_err_t ret = ESP_OK;
+    uint32_t started = 0;
+    for (uint32_t i = 0; i < num_outputs; i++) {
+        led_strip_output_t *output = &outputs[i];
+        output->inflight[output->inflight_tail] = back_frame;
+        esp_err_t err = output->backend->submit(output->backend, frame_buffers[back_frame] + output->offset, output->size);
+        if (err != ESP_OK) {
+            ret = err;
+            continue;
         }
-        if (session_state & RMT_ENCODING_MEM_FULL) {
-            state |= RMT_ENCODING_MEM_FULL;
-            goto out; // yield if there's no free space for encoding artifacts
+        output->inflight_tail = (output->inflight_tail + 1) % RMT_LED_STRIP_FRAME_BUFFERS;
+        started++;
+    }
+
+    if (started == 0) {
+        return ret; // the buffer never left, it stays acquired as the back buffer
+    }
+
+    if (started < num_outputs) {
+        // only wait for the outputs that actually took the frame
+        portENTER_CRITICAL(&pending_lock);
+        pending_outputs[back_frame] -= num_outputs - started;
+        bool frame_sent = pending_outputs[back_frame] == 0;
+        portEXIT_CRITICAL(&pending_lock);
+        if (frame_sent) {
+            xSemaphoreGive(free_frames);
         }
     }
-out:
-    *ret_state = state;
-    return encoded_symbols;
+
+    // a partly sent frame must not suppress the next one
+    last_frame_valid = started == num_outputs;
+    last_frame_time_us = now_us;
+    stats.frames_sent++;
+    back_frame_acquired = false;
+    back_frame = (back_frame + 1) % RMT_LED_STRIP_FRAME_BUFFERS;
+    return ret;
 }
 
-static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
+esp_err_t led_strip_submit_frame(void)
 {
-    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
-    rmt_del_encoder(led_encoder->bytes_encoder);
-    rmt_del_encoder(led_encoder->copy_encoder);
-    free(led_encoder);
-    return ESP_OK;
+    if (!num_outputs || !back_frame_acquired ||
+        xSemaphoreGetMutexHolder(frame_lock) != xTaskGetCurrentTaskHandle()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = led_strip_submit_locked();
+    xSemaphoreGive(frame_lock);
+    return ret;
+}
+
+void led_strip_set_brightness(uint8_t level)
+{
+    brightness = level;
 }
 
-static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
+uint8_t led_strip_get_brightness(void)
 {
-    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
-    rmt_encoder_reset(led_encoder->bytes_encoder);
-    rmt_encoder_reset(led_encoder->copy_encoder);
-    led_encoder->state = RMT_ENCODING_RESET;
+    return brightness;
+}
+
+esp_err_t led_strip_set_ranges(const led_strip_range_t *new_ranges, uint32_t count)
+{
+    if (count > RMT_LED_STRIP_MAX_RANGES || (count && !new_ranges)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!num_outputs) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t end = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (new_ranges[i].start < end || new_ranges[i].length > num_leds - new_ranges[i].start) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        end = new_ranges[i].start + new_ranges[i].length;
+    }
+
+    // Under the frame lock, so a frame being packed never sees half of them
+    bool owned = xSemaphoreGetMutexHolder(frame_lock) == xTaskGetCurrentTaskHandle();
+    if (!owned) {
+        xSemaphoreTake(frame_lock, portMAX_DELAY);
+    }
+    bool same = count == num_ranges;
+    for (uint32_t i = 0; same && i < count; i++) {
+        same = new_ranges[i].start == ranges[i].start && new_ranges[i].length == ranges[i].length &&
+               new_ranges[i].brightness == ranges[i].brightness;
+    }
+    if (!same) {
+        memcpy(ranges, new_ranges, count * sizeof(led_strip_range_t));
+        num_ranges = count;
+        settled_frames = 0; // the frame changes, dither it again
+    }
+    if (!owned) {
+        xSemaphoreGive(frame_lock);
+    }
     return ESP_OK;
 }
 
-esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+esp_err_t led_strip_get_stats(led_strip_stats_t *out)
 {
-    esp_err_t ret = ESP_OK;
-    rmt_led_strip_encoder_t *led_encoder = NULL;
-    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
-    led_encoder = rmt_alloc_encoder_mem(sizeof(rmt_led_strip_encoder_t));
-    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
-    led_encoder->base.encode = rmt_encode_led_strip;
-    led_encoder->base.del = rmt_del_led_strip_encoder;
-    led_encoder->base.reset = rmt_led_strip_encoder_reset;
-    // different led strip might have its own timing requirements, following parameter is for WS2812
-    rmt_bytes_encoder_config_t bytes_encoder_config = {
-        .bit0 = {
-            .level0 = 1,
-            .duration0 = WS2812_T0H * config->resolution / 1000000, // T0H=0.3us
-            .level1 = 0,
-            .duration1 = WS2812_T0L * config->resolution / 1000000, // T0L=0.9us
-        },
-        .bit1 = {
-            .level0 = 1,
-            .duration0 = WS2812_T1H * config->resolution / 1000000, // T1H=0.9us
-            .level1 = 0,
-            .duration1 = WS2812_T1L * config->resolution / 1000000, // T1L=0.3us
-        },
-        .flags.msb_first = 1 // WS2812 transfer bit order: G7...G0R7...R0B7...B0
-    };
-    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create bytes encoder failed");
-    rmt_copy_encoder_config_t copy_encoder_config = {};
-    ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder), err, TAG, "create copy encoder failed");
-
-    uint32_t reset_ticks = config->resolution / 1000000 * WS2812_RESET_DURATION / 2; // reset code duration defaults to 50us
-    led_encoder->reset_code = (rmt_symbol_word_t) {
-        .level0 = 0,
-        .duration0 = reset_ticks,
-        .level1 = 0,
-        .duration1 = reset_ticks,
-    };
-    *ret_encoder = &led_encoder->base;
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out = stats;
     return ESP_OK;
-err:
-    if (led_encoder) {
-        if (led_encoder->bytes_encoder) {
-            rmt_del_encoder(led_encoder->bytes_encoder);
+}
+
+esp_err_t led_strip_wait_done(int timeout_ms)
+{
+    if (!num_outputs) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (uint32_t i = 0; i < num_outputs; i++) {
+        esp_err_t ret = outputs[i].backend->wait_done(outputs[i].backend, timeout_ms);
+        if (ret != ESP_OK) {
+            return ret;
         }
-        if (led_encoder->copy_encoder) {
-            rmt_del_encoder(led_encoder->copy_encoder);
+    }
+    return ESP_OK;
+}
+
+// Dither while the framebuffer moves. Once it and the brightness have stood
+// still for RMT_LED_STRIP_DITHER_FRAMES frames every channel is rounded
+// instead, so the frames come out identical and the unchanged-frame skip
+// applies. A hash stands in for a copy of the last framebuffer.
+static led_color_t *led_strip_dither_buffer(const led_color_t *src)
+{
+#if RMT_LED_STRIP_DITHER
+    uint32_t hash = 2166136261u ^ lut_brightness;
+    for (uint32_t i = 0; i < num_leds; i++) {
+        uint32_t word;
+        memcpy(&word, &src[i], sizeof(word));
+        hash = (hash ^ word) * 16777619u;
+    }
+    if (hash != shown_hash) {
+        shown_hash = hash;
+        settled_frames = 0;
+    } else if (settled_frames < RMT_LED_STRIP_DITHER_FRAMES) {
+        settled_frames++;
+    }
+    return settled_frames < RMT_LED_STRIP_DITHER_FRAMES ? dither : NULL;
+#else
+    (void)src;
+    return NULL;
+#endif
+}
+
+// Pack the LEDs from..to of an output's segment
+static void led_strip_pack_span(const led_strip_output_t *output, const led_color_t *src, uint8_t *frame,
+                                led_color_t *error, uint32_t from, uint32_t to, uint16_t scale)
+{
+    if (from < to) {
+        output->pack(src + from, frame + output->offset + (from - output->first_led) * output->pixel_bytes,
+                     to - from, &lut, error ? error + from : NULL, scale);
+    }
+}
+
+static void led_strip_pack_outputs(const led_color_t *src, uint8_t *frame, bool shown)
+{
+    // Rescale here rather than in led_strip_set_brightness() so the tables
+    // never change while a frame is being packed
+    uint8_t level = brightness;
+    if (level != lut_brightness) {
+        led_pixel_lut_scale(&lut, &gamma_lut, level);
+        lut_brightness = level;
+    }
+
+    led_color_t *error = shown ? led_strip_dither_buffer(src) : NULL;
+    for (uint32_t i = 0; i < num_outputs; i++) {
+        const led_strip_output_t *output = &outputs[i];
+        // The LEDs between the ranges at full scale, every range scaled
+        uint32_t led = output->first_led;
+        uint32_t end = output->first_led + output->num_leds;
+        for (uint32_t j = 0; j < num_ranges && led < end; j++) {
+            uint32_t start = ranges[j].start > led ? ranges[j].start : led;
+            uint32_t stop = ranges[j].start + ranges[j].length < end ? ranges[j].start + ranges[j].length : end;
+            if (start >= stop) {
+                continue;
+            }
+            uint16_t scale = ranges[j].brightness + (ranges[j].brightness >> 7);
+            led_strip_pack_span(output, src, frame, error, led, start, LED_PIXEL_SCALE_FULL);
+            led_strip_pack_span(output, src, frame, error, start, stop, scale);
+            led = stop;
         }
-        free(led_encoder);
+        led_strip_pack_span(output, src, frame, error, led, end, LED_PIXEL_SCALE_FULL);
     }
-    return ret;
 }
 
-esp_err_t led_strip_set(uint8_t *led_strip_pixels) { 
-    if (!led_chan || !led_encoder || !led_strip_pixels) {
+esp_err_t led_strip_pack(const led_color_t *src, uint8_t *frame)
+{
+    if (!src || !frame) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!num_outputs) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    rmt_transmit_config_t tx_config = {
-        .loop_count = 0, // no transfer loop
-    };
+    // Under the frame lock, the tables may be rescaled. A frame that is not
+    // shown right away is rounded, the dither belongs to the shown frames.
+    bool owned = xSemaphoreGetMutexHolder(frame_lock) == xTaskGetCurrentTaskHandle();
+    if (!owned) {
+        xSemaphoreTake(frame_lock, portMAX_DELAY);
+    }
+    led_strip_pack_outputs(src, frame, false);
+    if (!owned) {
+        xSemaphoreGive(frame_lock);
+    }
+    return ESP_OK;
+}
+
+size_t led_strip_get_frame_size(void)
+{
+    return frame_size;
+}
 
-    // Flush RGB values to LEDs
-    esp_err_t ret = rmt_transmit(led_chan, led_encoder, led_strip_pixels, sizeof(uint8_t) * NUM_LEDS * 3, &tx_config);
+esp_err_t led_strip_show(void)
+{
+    uint8_t *frame = NULL;
+    esp_err_t ret = led_strip_acquire_frame(&frame, -1);
     if (ret != ESP_OK) {
         return ret;
     }
+    led_strip_pack_outputs(pixels, frame, true);
+    return led_strip_submit_frame();
+}
+
+esp_err_t led_strip_set(const led_color_t *led_strip_pixels) { 
+    if (!led_strip_pixels || !pixels) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    ret = rmt_tx_wait_all_done(led_chan, portMAX_DELAY);
+    // Copy under the frame lock, so a frame being packed never sees half of it
+    uint8_t *frame = NULL;
+    esp_err_t ret = led_strip_acquire_frame(&frame, -1);
     if (ret != ESP_OK) {
         return ret;
     }
+    memcpy(pixels, led_strip_pixels, num_leds * sizeof(led_color_t));
+    led_strip_pack_outputs(pixels, frame, true);
+    return led_strip_submit_frame();
+}
 
-    vTaskDelay(pdMS_TO_TICKS(RMT_LED_STRIP_CHASE_SPEED_MS));
-    return ESP_OK;
+led_color_t *led_strip_get_pixels(void)
+{
+    return pixels;
 }
 
-esp_err_t led_strip_init(const led_strip_config_t *config) {
-    // Use default configuration if none provided
-    led_strip_config_t default_config = {
+uint32_t led_strip_get_num_leds(void)
+{
+    return num_leds;
+}
+
+void led_strip_get_default_config(led_strip_config_t *config)
+{
+    *config = (led_strip_config_t) {
         .resolution_hz = RMT_LED_STRIP_RESOLUTION_HZ,
-        .gpio_num = RMT_LED_STRIP_GPIO_NUM,
         .mem_block_symbols = RMT_LED_STRIP_MEM_BLOCK_SYMBOLS,
-        .trans_queue_depth = RMT_LED_STRIP_TRANS_QUEUE_DEPTH
+        .trans_queue_depth = RMT_LED_STRIP_TRANS_QUEUE_DEPTH,
+        .gamma = { RMT_LED_STRIP_GAMMA, RMT_LED_STRIP_GAMMA, RMT_LED_STRIP_GAMMA, RMT_LED_STRIP_GAMMA },
+        .num_outputs = 1,
+        .outputs = {
+            {
+                .backend = LED_STRIP_BACKEND_RMT,
+                .pixel_format = LED_PIXEL_FORMAT_GRB,
+                .timing = LED_TIMING_WS2812B,
+                .gpio_num = RMT_LED_STRIP_GPIO_NUM,
+                .num_leds = RMT_LED_STRIP_NUM_LEDS,
+            },
+        },
     };
-    
-    const led_strip_config_t *cfg = config ? config : &default_config;
+}
 
-    rmt_tx_channel_config_t tx_chan_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT,
-        .gpio_num = cfg->gpio_num,
-        .mem_block_symbols = cfg->mem_block_symbols,
-        .resolution_hz = cfg->resolution_hz,
-        .trans_queue_depth = cfg->trans_queue_depth,
-    };
+static bool led_strip_config_valid(const led_strip_config_t *config)
+{
+    if (config->num_outputs == 0 || config->num_outputs > RMT_LED_STRIP_MAX_OUTPUTS) {
+        return false;
+    }
+    uint32_t total = 0;
+    uint32_t spi_outputs = 0;
+    for (uint32_t i = 0; i < config->num_outputs; i++) {
+        if (config->outputs[i].num_leds == 0 || config->outputs[i].backend >= LED_STRIP_BACKEND_MAX ||
+            config->outputs[i].pixel_format >= LED_PIXEL_FORMAT_MAX || config->outputs[i].timing >= LED_TIMING_MAX ||
+            !GPIO_IS_VALID_OUTPUT_GPIO(config->outputs[i].gpio_num)) {
+            return false;
+        }
+        // Checked before adding, so a huge length cannot wrap the total around
+        if (config->outputs[i].num_leds > RMT_LED_STRIP_MAX_LEDS - total) {
+            return false;
+        }
+        if (config->outputs[i].backend == LED_STRIP_BACKEND_SPI) {
+            // Refused here rather than at the next boot
+            led_spi_code_t code;
+            uint32_t clock_hz;
+            if (!led_spi_code_for_timing(led_timing_get(config->outputs[i].timing), LED_STRIP_SPI_TOLERANCE_NS,
+                                         &code, &clock_hz)) {
+                return false;
+            }
+            spi_outputs++;
+        }
+        total += config->outputs[i].num_leds;
+    }
+    return spi_outputs <= LED_STRIP_SPI_MAX_OUTPUTS;
+}
 
-    ESP_LOGI(TAG, "Create RMT TX channel");
-    esp_err_t ret = rmt_new_tx_channel(&tx_chan_config, &led_chan);
-    if (ret != ESP_OK) {
-        return ret;
+esp_err_t led_strip_load_config(led_strip_config_t *config)
+{
+    if (!config) {
+        return ESP_ERR_INVALID_ARG;
     }
+    led_strip_get_default_config(config);
 
-    ESP_LOGI(TAG, "Install led strip encoder");
-    led_strip_encoder_config_t encoder_config = {
-        .resolution = cfg->resolution_hz,
-    };
-    ret = rmt_new_led_strip_encoder(&encoder_config, &led_encoder);
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(RMT_LED_STRIP_NVS_NAMESPACE, NVS_READONLY, &nvs);
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK; // nothing stored yet
+    }
     if (ret != ESP_OK) {
-        rmt_del_channel(led_chan);
-        led_chan = NULL;
         return ret;
     }
 
-    ESP_LOGI(TAG, "Enable RMT TX channel");
-    ret = rmt_enable(led_chan);
+    // Keys that are missing keep their default value
+    led_strip_config_t stored = *config;
+    uint8_t stored_outputs = 0;
+    if (nvs_get_u8(nvs, "num_outputs", &stored_outputs) == ESP_OK) {
+        stored.num_outputs = stored_outputs;
+    }
+    for (uint32_t i = 0; i < RMT_LED_STRIP_MAX_OUTPUTS; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "gpio%lu", (unsigned long)i);
+        nvs_get_u8(nvs, key, &stored.outputs[i].gpio_num);
+        snprintf(key, sizeof(key), "leds%lu", (unsigned long)i);
+        nvs_get_u32(nvs, key, &stored.outputs[i].num_leds);
+        uint8_t backend = 0;
+        snprintf(key, sizeof(key), "backend%lu", (unsigned long)i);
+        if (nvs_get_u8(nvs, key, &backend) == ESP_OK) {
+            stored.outputs[i].backend = backend;
+        }
+        uint8_t pixel_format = 0;
+        snprintf(key, sizeof(key), "format%lu", (unsigned long)i);
+        if (nvs_get_u8(nvs, key, &pixel_format) == ESP_OK) {
+            stored.outputs[i].pixel_format = pixel_format;
+        }
+        uint8_t timing = 0;
+        snprintf(key, sizeof(key), "timing%lu", (unsigned long)i);
+        if (nvs_get_u8(nvs, key, &timing) == ESP_OK) {
+            stored.outputs[i].timing = timing;
+        }
+    }
+    nvs_close(nvs);
+
+    if (!led_strip_config_valid(&stored)) {
+        ESP_LOGW(TAG, "Ignoring invalid strip configuration from NVS");
+        return ESP_OK;
+    }
+    *config = stored;
+    return ESP_OK;
+}
+
+esp_err_t led_strip_store_config(const led_strip_config_t *config)
+{
+    if (!config || !led_strip_config_valid(config)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_handle_t nvs;
+    esp_err_t ret = nvs_open(RMT_LED_STRIP_NVS_NAMESPACE, NVS_READWRITE, &nvs);
     if (ret != ESP_OK) {
-        rmt_del_encoder(led_encoder);
-        rmt_del_channel(led_chan);
-        led_chan = NULL;
-        led_encoder = NULL;
         return ret;
     }
+    ret = nvs_set_u8(nvs, "num_outputs", config->num_outputs);
+    for (uint32_t i = 0; i < config->num_outputs && ret == ESP_OK; i++) {
+        char key[16];
+        snprintf(key, sizeof(key), "gpio%lu", (unsigned long)i);
+        ret = nvs_set_u8(nvs, key, config->outputs[i].gpio_num);
+        if (ret == ESP_OK) {
+            snprintf(key, sizeof(key), "leds%lu", (unsigned long)i);
+            ret = nvs_set_u32(nvs, key, config->outputs[i].num_leds);
+        }
+        if (ret == ESP_OK) {
+            snprintf(key, sizeof(key), "backend%lu", (unsigned long)i);
+            ret = nvs_set_u8(nvs, key, config->outputs[i].backend);
+        }
+        if (ret == ESP_OK) {
+            snprintf(key, sizeof(key), "format%lu", (unsigned long)i);
+            ret = nvs_set_u8(nvs, key, config->outputs[i].pixel_format);
+        }
+        if (ret == ESP_OK) {
+            snprintf(key, sizeof(key), "timing%lu", (unsigned long)i);
+            ret = nvs_set_u8(nvs, key, config->outputs[i].timing);
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return ret;
+}
+
+static void *led_strip_alloc(size_t size, const char *what)
+{
+    // Internal RAM keeps the encoder fast, long strips may only fit in PSRAM
+    void *mem = heap_caps_calloc(1, size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!mem) {
+        mem = heap_caps_calloc(1, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!mem) {
+            ESP_LOGE(TAG, "No memory for %u byte %s", (unsigned)size, what);
+            return NULL;
+        }
+        ESP_LOGI(TAG, "%s allocated in PSRAM", what);
+    }
+    return mem;
+}
+
+static esp_err_t led_strip_alloc_frames(size_t size, uint32_t leds)
+{
+    pixels = led_strip_alloc(leds * sizeof(led_color_t), "framebuffer");
+    if (!pixels) {
+        return ESP_ERR_NO_MEM;
+    }
+    dither = led_strip_alloc(leds * sizeof(led_color_t), "dither buffer");
+    if (!dither) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(dither, 0x80, leds * sizeof(led_color_t)); // round the first frame
+    frame_memory = led_strip_alloc(size * RMT_LED_STRIP_FRAME_BUFFERS, "frame buffers");
+    if (!frame_memory) {
+        return ESP_ERR_NO_MEM;
+    }
 
+    for (int i = 0; i < RMT_LED_STRIP_FRAME_BUFFERS; i++) {
+        frame_buffers[i] = frame_memory + i * size;
+    }
+    frame_size = size;
+    num_leds = leds;
     return ESP_OK;
 }
+
+static void led_strip_release(void)
+{
+    for (uint32_t i = 0; i < RMT_LED_STRIP_MAX_OUTPUTS; i++) {
+        if (outputs[i].backend) {
+            outputs[i].backend->del(outputs[i].backend);
+        }
+    }
+    memset(outputs, 0, sizeof(outputs));
+    num_outputs = 0;
+    num_ranges = 0;
+
+    if (free_frames) {
+        vSemaphoreDelete(free_frames);
+        free_frames = NULL;
+    }
+    if (frame_lock) {
+        vSemaphoreDelete(frame_lock);
+        frame_lock = NULL;
+    }
+    heap_caps_free(frame_memory);
+    frame_memory = NULL;
+    heap_caps_free(pixels);
+    pixels = NULL;
+    heap_caps_free(dither);
+    dither = NULL;
+    memset(frame_buffers, 0, sizeof(frame_buffers));
+    frame_size = 0;
+    num_leds = 0;
+    back_frame = 0;
+    back_frame_acquired = false;
+    last_frame_valid = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+esp_err_t led_strip_init(const led_strip_config_t *config) {
+    esp_err_t ret = ESP_OK;
+    // Use default configuration if none provided
+    led_strip_config_t default_config;
+    led_strip_get_default_config(&default_config);
+    
+    const led_strip_config_t *cfg = config ? config : &default_config;
+    ESP_RETURN_ON_FALSE(!num_outputs, ESP_ERR_INVALID_STATE, TAG, "already initialized");
+    // every frame buffer must fit in the queue so submit never blocks
+    ESP_RETURN_ON_FALSE(cfg->trans_queue_depth >= RMT_LED_STRIP_FRAME_BUFFERS, ESP_ERR_INVALID_ARG, TAG, "trans queue too short");
+    ESP_RETURN_ON_FALSE(led_strip_config_valid(cfg), ESP_ERR_INVALID_ARG, TAG, "invalid output configuration");
+
+    uint32_t total_leds = 0;
+    size_t total_size = 0;
+    for (uint32_t i = 0; i < cfg->num_outputs; i++) {
+        total_leds += cfg->outputs[i].num_leds;
+        total_size += cfg->outputs[i].num_leds * led_pixel_format_bytes(cfg->outputs[i].pixel_format);
+    }
+
+    ESP_LOGI(TAG, "Allocate frame buffers for %lu LEDs", (unsigned long)total_leds);
+    ESP_GOTO_ON_ERROR(led_strip_alloc_frames(total_size, total_leds), err, TAG, "alloc frame buffers failed");
+    led_pixel_lut_build(&gamma_lut, &cfg->gamma);
+    lut_brightness = brightness;
+    led_pixel_lut_scale(&lut, &gamma_lut, lut_brightness);
+
+    free_frames = xSemaphoreCreateCounting(RMT_LED_STRIP_FRAME_BUFFERS, RMT_LED_STRIP_FRAME_BUFFERS);
+    ESP_GOTO_ON_FALSE(free_frames, ESP_ERR_NO_MEM, err, TAG, "no mem for frame semaphore");
+    frame_lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(frame_lock, ESP_ERR_NO_MEM, err, TAG, "no mem for frame lock");
+
+    // Each output drives one contiguous segment of the logical frame
+    size_t offset = 0;
+    uint32_t first_led = 0;
+    int spi_host = SPI2_HOST;
+    for (uint32_t i = 0; i < cfg->num_outputs; i++) {
+        led_strip_output_t *output = &outputs[i];
+        output->pack = led_pixel_get_packer(cfg->outputs[i].pixel_format);
+        output->first_led = first_led;
+        output->num_leds = cfg->outputs[i].num_leds;
+        output->offset = offset;
+        output->pixel_bytes = led_pixel_format_bytes(cfg->outputs[i].pixel_format);
+        output->size = cfg->outputs[i].num_leds * output->pixel_bytes;
+        first_led += output->num_leds;
+        offset += output->size;
+
+        led_output_config_t output_config = {
+            .gpio_num = cfg->outputs[i].gpio_num,
+            .max_size = output->size,
+            .trans_queue_depth = cfg->trans_queue_depth,
+            .timing = led_timing_get(cfg->outputs[i].timing),
+            .on_done = led_strip_output_done,
+            .user_ctx = output,
+            .rmt = {
+                .resolution_hz = cfg->resolution_hz,
+                .mem_block_symbols = cfg->mem_block_symbols,
+            },
+        };
+
+        ESP_LOGI(TAG, "Create output %lu on GPIO %d for %lu %s LEDs", (unsigned long)i, cfg->outputs[i].gpio_num,
+                 (unsigned long)cfg->outputs[i].num_leds, led_pixel_format_name(cfg->outputs[i].pixel_format));
+        switch (cfg->outputs[i].backend) {
+        case LED_STRIP_BACKEND_SPI:
+            output_config.spi.host = spi_host++;
+            ESP_GOTO_ON_ERROR(led_output_new_spi(&output_config, &output->backend), err, TAG, "create SPI output failed");
+            break;
+        case LED_STRIP_BACKEND_RMT:
+        default:
+            ESP_GOTO_ON_ERROR(led_output_new_rmt(&output_config, &output->backend), err, TAG, "create RMT output failed");
+            break;
+        }
+    }
+
+    num_outputs = cfg->num_outputs;
+    return ESP_OK;
+err:
+    led_strip_release();
+    return ret;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ws2812_animations.h"
+#include "ws2812_pixel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Bytes of private state every running effect has room for
+ */
+#define ANIMATION_EFFECT_STATE_SIZE 32
+
+/**
+ * @brief Bytes of private state every running effect has for each LED of its span
+ */
+#define ANIMATION_EFFECT_LED_STATE_SIZE 1
+
+/**
+ * @brief The pixels an effect renders into
+ *
+ * Kernels only ever see a span, so the same kernel serves the whole strip and
+ * every segment size.
+ */
+typedef struct {
+    led_color_t *pixels;       /*!< First pixel of the span */
+    uint32_t num_leds;         /*!< Length of the span */
+    uint16_t *scratch;         /*!< num_leds 16-bit values of scratch, shared by all effects and lost between frames */
+    uint8_t *led_state;        /*!< ANIMATION_EFFECT_LED_STATE_SIZE bytes per LED, owned by the effect */
+    const led_color_t *palette; /*!< 256 colors of the effect's palette, NULL if it uses none */
+} animation_span_t;
+
+/**
+ * @brief Where an effect is in time
+ *
+ * Effects compute their look from the clock, never from a count of frames,
+ * so they move at the same pace at any frame rate and strip length.
+ */
+typedef struct {
+    int64_t time_us;           /*!< Real time since the effect started */
+    uint64_t phase;            /*!< Speed steps since the effect started in Q16, a speed change keeps it continuous */
+    uint32_t steps;            /*!< Whole speed steps since the last render */
+} animation_clock_t;
+
+/**
+ * @brief Position in a cycle of a number of speed steps
+ *
+ * @param clock Effect clock
+ * @param steps_per_cycle Length of the cycle, so it runs at
+ *        1000 / (speed * steps_per_cycle) cycles per second
+ * @return uint32_t Fraction of the cycle done, 0-65535
+ */
+static inline uint32_t animation_cycle_phase(const animation_clock_t *clock, uint32_t steps_per_cycle)
+{
+    uint64_t cycle = (uint64_t)steps_per_cycle << 16;
+    return (clock->phase % cycle) / steps_per_cycle;
+}
+
+/**
+ * @brief Effect interface
+ *
+ * An effect owns state_size bytes of state and led_state_size bytes per LED
+ * of span::led_state, both zeroed when the effect starts. It is registered in
+ * animation_effects[] under its animation type.
+ */
+typedef struct {
+    animation_effect_info_t info;  /*!< What the web interface shows */
+    size_t state_size;             /*!< Private state, at most ANIMATION_EFFECT_STATE_SIZE */
+    size_t led_state_size;         /*!< Private state per LED, at most ANIMATION_EFFECT_LED_STATE_SIZE */
+    bool continuous;               /*!< Render every frame, for effects that move between speed steps */
+    led_palette_id_t palette;      /*!< Palette used when the configuration names none, LED_PALETTE_NONE if the effect uses none */
+
+    /**
+     * @brief Set up the state for the first frame, NULL if zeroed state is the first frame
+     */
+    void (*init)(void *state, const animation_config_t *config);
+
+    /**
+     * @brief Number of speed steps after which the frames repeat, NULL or 0 if they never do
+     *
+     * Only for effects whose frames depend on nothing but the configuration,
+     * the span length and clock::phase. Their frames can then be cached and
+     * played back without rendering: one per step, or for continuous effects
+     * one per frame at ANIMATION_TARGET_FPS over the period * speed ms.
+     */
+    uint32_t (*period)(const animation_config_t *config, uint32_t num_leds);
+
+    /**
+     * @brief Render the span at a point of the effect clock
+     *
+     * Every pixel of the span is written. Effects render when a whole speed
+     * step passed or the configuration changed, continuous effects on every
+     * frame. Rendering never blocks.
+     */
+    void (*render)(void *state, const animation_config_t *config, const animation_span_t *span,
+                   const animation_clock_t *clock);
+} animation_effect_def_t;
+
+/**
+ * @brief Effect registry, indexed by animation type
+ */
+extern const animation_effect_def_t animation_effects[ANIMATION_MAX];
+
+#ifdef __cplusplus
+}
+#endif
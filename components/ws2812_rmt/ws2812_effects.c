@@ -0,0 +1,492 @@
+#include <string.h>
+#include "esp_random.h"
+#include "ws2812_effect.h"
+#include "ws2812_math.h"
+#include "ws2812_noise.h"
+#include "ws2812_random.h"
+
+// Each effect keeps its state in its own struct, so nothing carries over
+// from one effect to the next. Periodic effects need none: they compute
+// every frame from the effect clock.
+
+static void off_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                       const animation_clock_t *clock)
+{
+    // No animation - keep LEDs off
+    memset(span->pixels, 0, span->num_leds * sizeof(led_color_t));
+}
+
+// Static effects repeat every step
+static uint32_t static_period(const animation_config_t *config, uint32_t num_leds)
+{
+    return 1;
+}
+
+static void solid_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                         const animation_clock_t *clock)
+{
+    // Set all LEDs to the same color
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        span->pixels[i] = (led_color_t){ .r = config->r, .g = config->g, .b = config->b };
+    }
+}
+
+#define RAINBOW_STEPS       360 // speed steps per hue turn
+
+static uint32_t rainbow_period(const animation_config_t *config, uint32_t num_leds)
+{
+    return RAINBOW_STEPS;
+}
+
+static void rainbow_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                           const animation_clock_t *clock)
+{
+    // Rainbow animation - the whole palette spread over the span, by
+    // default the hue wheel
+    uint16_t hue_step = 65536 / span->num_leds;
+    uint16_t led_hue = animation_cycle_phase(clock, RAINBOW_STEPS);
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        span->pixels[i] = span->palette[led_hue >> 8];
+        led_hue += hue_step;
+    }
+}
+
+#define BREATHING_STEPS     200 // speed steps per breath, out and back in
+
+static uint32_t breathing_period(const animation_config_t *config, uint32_t num_leds)
+{
+    return BREATHING_STEPS;
+}
+
+static void breathing_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                             const animation_clock_t *clock)
+{
+    // Breathing animation - fade out from full and back in
+    uint32_t phase = animation_cycle_phase(clock, BREATHING_STEPS);
+    uint32_t scale = phase < 32768 ? 65535 - 2 * phase : 2 * phase - 65536; // Q16
+    led_color_t color = {
+        .r = (config->r * scale + 0x8000) >> 16,
+        .g = (config->g * scale + 0x8000) >> 16,
+        .b = (config->b * scale + 0x8000) >> 16,
+    };
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        span->pixels[i] = color;
+    }
+}
+
+static uint32_t chase_period(const animation_config_t *config, uint32_t num_leds)
+{
+    return num_leds;
+}
+
+static void chase_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                         const animation_clock_t *clock)
+{
+    // Chase animation - moving dot, one LED per speed step
+    memset(span->pixels, 0, span->num_leds * sizeof(led_color_t));
+    uint32_t position = (clock->phase >> 16) % span->num_leds;
+    span->pixels[position] = (led_color_t){ .r = config->r, .g = config->g, .b = config->b };
+}
+
+typedef struct {
+    led_rand_t rng;
+} random_state_t;
+_Static_assert(sizeof(random_state_t) <= ANIMATION_EFFECT_STATE_SIZE, "random state too large");
+
+// A configured seed replays the same frames. Without one every start is
+// seeded from the hardware RNG, and the count of starts keeps two segments
+// started together apart even if it repeated, so no two starts and no two
+// boots flicker alike.
+static uint32_t effect_seed(const animation_config_t *config)
+{
+    static uint32_t starts;
+    return config->seed ? config->seed : esp_random() ^ ++starts;
+}
+
+static void random_init(void *state, const animation_config_t *config)
+{
+    random_state_t *random = state;
+    led_rand_seed(&random->rng, effect_seed(config));
+}
+
+// Heat field fire: every step cools each cell a little, lets the heat drift
+// up from the base and may light a spark near the base. Heat indexes the
+// palette, black-red-yellow-white by default. 8-bit integers, O(N) per step.
+#define FIRE_COOLING        55 // average cooling per step, less on longer spans
+#define FIRE_SPARKING       120 // chance of a spark per step, out of 256
+#define FIRE_SPARK_CELLS    7  // sparks light in this many cells at the base
+#define FIRE_MAX_STEPS      8  // a frame after a stall catches up at most this far
+
+static void fire_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                        const animation_clock_t *clock)
+{
+    // The base of the fire is the start of the span, mirrored and reversed
+    // segments give fires from both ends or from the center out
+    random_state_t *random = state;
+    uint8_t *heat = span->led_state;
+    uint8_t *cooling = (uint8_t *)span->scratch;
+    const uint32_t num_leds = span->num_leds;
+    uint32_t cooling_range = FIRE_COOLING * 10 / num_leds + 2;
+    if (cooling_range > 256) {
+        cooling_range = 256;
+    }
+    uint32_t spark_cells = num_leds < FIRE_SPARK_CELLS ? num_leds : FIRE_SPARK_CELLS;
+
+    for (uint32_t step = 0; step < clock->steps && step < FIRE_MAX_STEPS; step++) {
+        // Cool down every cell a little
+        led_rand_fill_range(&random->rng, cooling, num_leds, 0, cooling_range);
+        for (uint32_t i = 0; i < num_leds; i++) {
+            heat[i] = heat[i] > cooling[i] ? heat[i] - cooling[i] : 0;
+        }
+        // Heat drifts up and diffuses, (a + 2b) / 3 as a multiply and shift
+        for (uint32_t i = num_leds - 1; i >= 2; i--) {
+            heat[i] = ((heat[i - 1] + 2 * heat[i - 2]) * 171) >> 9;
+        }
+        // Now and then a new spark near the base
+        if (led_rand8(&random->rng) < FIRE_SPARKING) {
+            uint32_t cell = led_rand_range(&random->rng, spark_cells);
+            uint32_t spark = heat[cell] + 160 + led_rand_range(&random->rng, 96);
+            heat[cell] = spark > 255 ? 255 : spark;
+        }
+    }
+
+    for (uint32_t i = 0; i < num_leds; i++) {
+        span->pixels[i] = span->palette[heat[i]];
+    }
+}
+
+// Lightning: quiet, then a strike of a few flashes with dark gaps between
+// them, then an afterglow that fades out. Every phase ends at an absolute
+// time on the effect clock, so the timing does not depend on the frame rate.
+#define LIGHTNING_QUIET_STEPS   40  // quiet time is up to this many speed periods, 20 on average
+#define LIGHTNING_FLASHES       2   // flashes per strike, at least
+#define LIGHTNING_MORE_FLASHES  4   // and up to this many more
+#define LIGHTNING_FLASH_MS      20  // a flash lasts at least this long
+#define LIGHTNING_DARK_MS       30  // a dark gap between flashes lasts at least this long
+#define LIGHTNING_AFTERGLOW_MS  200 // the afterglow lasts at least this long
+#define LIGHTNING_GLOW_LEVEL    96  // afterglow level at its start, out of 255
+
+typedef enum {
+    LIGHTNING_QUIET = 0,
+    LIGHTNING_FLASH,
+    LIGHTNING_DARK,
+    LIGHTNING_AFTERGLOW,
+} lightning_phase_t;
+
+typedef struct {
+    led_rand_t rng;
+    uint8_t phase;             // lightning_phase_t
+    uint8_t flashes;           // flashes left in this strike
+    uint8_t level;             // brightness of the current flash
+    int64_t start_us;          // start of the current phase on the effect clock
+    int64_t end_us;
+} lightning_state_t;
+_Static_assert(sizeof(lightning_state_t) <= ANIMATION_EFFECT_STATE_SIZE, "lightning state too large");
+
+static void lightning_init(void *state, const animation_config_t *config)
+{
+    lightning_state_t *lightning = state;
+    led_rand_seed(&lightning->rng, effect_seed(config));
+    // As if an afterglow just ended, so the first frame starts a quiet period
+    lightning->phase = LIGHTNING_AFTERGLOW;
+}
+
+static int64_t lightning_ms(lightning_state_t *lightning, uint32_t min_ms)
+{
+    // Between min_ms and 3.5 times min_ms
+    return (min_ms + led_rand_range(&lightning->rng, min_ms * 5 / 2 + 1)) * 1000LL;
+}
+
+// Move on to the next phase, which starts exactly where the current one ended
+static void lightning_next(lightning_state_t *lightning, const animation_config_t *config,
+                           const animation_span_t *span)
+{
+    int64_t duration_us;
+    switch (lightning->phase) {
+    case LIGHTNING_QUIET:
+        lightning->flashes = LIGHTNING_FLASHES + led_rand_range(&lightning->rng, LIGHTNING_MORE_FLASHES + 1);
+        lightning->level = 255; // the first flash is the brightest
+        // fall through
+    case LIGHTNING_DARK:
+        // A flash, with a new random intensity for every LED, between 200-254
+        lightning->phase = LIGHTNING_FLASH;
+        led_rand_fill_range(&lightning->rng, span->led_state, span->num_leds, 200, 55);
+        duration_us = lightning_ms(lightning, LIGHTNING_FLASH_MS);
+        break;
+    case LIGHTNING_FLASH:
+        if (--lightning->flashes > 0) {
+            lightning->phase = LIGHTNING_DARK;
+            lightning->level = 128 + led_rand_range(&lightning->rng, 128);
+            duration_us = lightning_ms(lightning, LIGHTNING_DARK_MS);
+        } else {
+            lightning->phase = LIGHTNING_AFTERGLOW;
+            duration_us = lightning_ms(lightning, LIGHTNING_AFTERGLOW_MS);
+        }
+        break;
+    case LIGHTNING_AFTERGLOW:
+    default:
+        lightning->phase = LIGHTNING_QUIET;
+        duration_us = led_rand_range(&lightning->rng, LIGHTNING_QUIET_STEPS) * (config->speed ? config->speed : 1) *
+                      1000LL;
+        break;
+    }
+    lightning->start_us = lightning->end_us;
+    lightning->end_us += duration_us;
+}
+
+static void lightning_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                             const animation_clock_t *clock)
+{
+    lightning_state_t *lightning = state;
+    // Catch up on every phase that ended since the last frame
+    while (clock->time_us >= lightning->end_us) {
+        lightning_next(lightning, config, span);
+    }
+
+    uint32_t level;
+    switch (lightning->phase) {
+    case LIGHTNING_FLASH:
+        level = lightning->level;
+        break;
+    case LIGHTNING_AFTERGLOW: {
+        // Fades out with the square of the remaining time
+        uint32_t left = (lightning->end_us - clock->time_us) * 256 / (lightning->end_us - lightning->start_us);
+        level = (LIGHTNING_GLOW_LEVEL * ((left * left) >> 8)) >> 8;
+        break;
+    }
+    default:
+        memset(span->pixels, 0, span->num_leds * sizeof(led_color_t));
+        return;
+    }
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        // More blue for lightning effect
+        uint8_t intensity = (span->led_state[i] * level) >> 8;
+        span->pixels[i] = (led_color_t){ .r = intensity, .g = intensity, .b = level };
+    }
+}
+
+// Angle of a wave that turns by angle_per_step every speed step
+static inline uint16_t wave_phase(const animation_clock_t *clock, uint16_t angle_per_step)
+{
+    return (clock->phase * angle_per_step) >> 16;
+}
+
+static void ocean_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                         const animation_clock_t *clock)
+{
+    // Ocean wave animation - gentle blue waves, running at 1, 0.7 and 0.3 times the speed
+    uint16_t phase1 = wave_phase(clock, LED_ANGLE_FROM_RAD(0.05));
+    uint16_t phase2 = wave_phase(clock, LED_ANGLE_FROM_RAD(0.035));
+    uint16_t phase3 = wave_phase(clock, LED_ANGLE_FROM_RAD(0.015));
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        // Create a wave pattern with multiple frequencies, all in Q16
+        uint32_t wave1 = led_wave16(phase1 + i * LED_ANGLE_FROM_RAD(0.2));
+        uint32_t wave2 = led_wave16(phase2 + i * LED_ANGLE_FROM_RAD(0.1));
+        uint32_t wave3 = led_wave16(phase3 + i * LED_ANGLE_FROM_RAD(0.05));
+        // weights 0.5, 0.3 and 0.2 of a 0.7 peak, in Q8
+        uint32_t intensity = (wave1 * 90 + wave2 * 54 + wave3 * 36) >> 8;
+
+        // Intensity indexes the palette, by default from deep to light blue
+        span->pixels[i] = span->palette[intensity >> 8];
+    }
+}
+
+static void aurora_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                          const animation_clock_t *clock)
+{
+    // Aurora borealis effect - flowing green/purple waves, running at 1, 0.7
+    // and 0.3 times the speed
+    uint16_t phase1 = wave_phase(clock, LED_ANGLE_FROM_RAD(0.03));
+    uint16_t phase2 = wave_phase(clock, LED_ANGLE_FROM_RAD(0.021));
+    uint16_t phase3 = wave_phase(clock, LED_ANGLE_FROM_RAD(0.009));
+    // The waves span 3, 2 and 1 radians over the span, angles per LED in Q16
+    uint32_t pos_step1 = ((uint32_t)LED_ANGLE_FROM_RAD(3.0) << 16) / span->num_leds;
+    uint32_t pos_step2 = ((uint32_t)LED_ANGLE_FROM_RAD(2.0) << 16) / span->num_leds;
+    uint32_t pos_step3 = ((uint32_t)LED_ANGLE_FROM_RAD(1.0) << 16) / span->num_leds;
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        // Create flowing aurora patterns, all in Q16
+        uint32_t wave1 = led_wave16(phase1 + ((i * pos_step1) >> 16));
+        uint32_t wave2 = led_wave16(phase2 + ((i * pos_step2) >> 16));
+        uint32_t wave3 = led_wave16(phase3 + ((i * pos_step3) >> 16));
+        // weights 0.5, 0.3 and 0.2 of a 0.8 peak, in Q8
+        uint32_t intensity = (wave1 * 102 + wave2 * 61 + wave3 * 41) >> 8;
+
+        // The second wave picks the color from the palette, by default from
+        // green to purple, and the sum of the waves sets its intensity
+        led_color_t color = span->palette[wave2 >> 8];
+        span->pixels[i] = (led_color_t){
+            .r = (color.r * intensity) >> 16,
+            .g = (color.g * intensity) >> 16,
+            .b = (color.b * intensity) >> 16,
+        };
+    }
+}
+
+// Noise effects: value noise moves along the span and changes shape over
+// time, so unlike the waves above the pattern never repeats. Positions and
+// times are Q16 lattice cells.
+#define NOISE_OCEAN_LEDS        12   // LEDs per noise cell
+#define NOISE_OCEAN_DRIFT       512  // cells per speed step the waves travel along the span, in Q16
+#define NOISE_OCEAN_CHANGE      256  // cells per speed step the waves change shape, in Q16
+#define NOISE_AURORA_COLOR_LEDS 40   // LEDs per cell of the color bands
+#define NOISE_AURORA_COLOR_CHANGE 128 // cells per speed step the color bands change, in Q16
+#define NOISE_AURORA_LEDS       8    // LEDs per cell of the curtains
+#define NOISE_AURORA_DRIFT      384  // cells per speed step the curtains travel, in Q16
+#define NOISE_AURORA_CHANGE     512  // cells per speed step the curtains change shape, in Q16
+#define NOISE_AURORA_SHIMMER    192  // cells per speed step the curtains shimmer, in Q16
+#define NOISE_LAVA_LEDS         10   // LEDs per noise cell
+#define NOISE_LAVA_DRIFT        256  // cells per speed step the blobs rise, in Q16
+#define NOISE_LAVA_CHANGE       192  // cells per speed step the blobs change shape, in Q16
+
+// Noise time that moves by cells_per_step every speed step
+static inline uint32_t noise_time(const animation_clock_t *clock, uint32_t cells_per_step)
+{
+    return (clock->phase * cells_per_step) >> 16;
+}
+
+// Octaves of noise mostly stay in the middle of their range, stretch 1/6..5/6
+// to the whole palette
+static inline uint8_t noise_index(uint32_t value)
+{
+    int32_t stretched = ((int32_t)value - 10923) * 3 / 2;
+    return stretched < 0 ? 0 : stretched > 65535 ? 255 : stretched >> 8;
+}
+
+static void ocean_noise_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                               const animation_clock_t *clock)
+{
+    // Ocean from noise - waves that travel along the span and never repeat
+    uint16_t *noise = span->scratch;
+    led_noise16_fill(noise, span->num_leds, noise_time(clock, NOISE_OCEAN_DRIFT), 65536 / NOISE_OCEAN_LEDS,
+                     noise_time(clock, NOISE_OCEAN_CHANGE), 0, 2);
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        span->pixels[i] = span->palette[noise_index(noise[i])];
+    }
+}
+
+static void aurora_noise_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                                const animation_clock_t *clock)
+{
+    // Aurora from noise - broad color bands, and curtains of light over them
+    // that drift, change and shimmer, with dark gaps between them
+    uint8_t *color = span->led_state;
+    uint16_t *curtain = span->scratch;
+    led_noise8_fill(color, span->num_leds, 0, 65536 / NOISE_AURORA_COLOR_LEDS,
+                    noise_time(clock, NOISE_AURORA_COLOR_CHANGE), 0, 1);
+    led_noise16_fill(curtain, span->num_leds, noise_time(clock, NOISE_AURORA_DRIFT), 65536 / NOISE_AURORA_LEDS,
+                     noise_time(clock, NOISE_AURORA_CHANGE), noise_time(clock, NOISE_AURORA_SHIMMER), 2);
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        uint32_t level = noise_index(curtain[i]) + 1;
+        level = level * level; // Q16, squared for darker gaps
+        led_color_t c = span->palette[color[i]];
+        span->pixels[i] = (led_color_t){
+            .r = (c.r * level) >> 16,
+            .g = (c.g * level) >> 16,
+            .b = (c.b * level) >> 16,
+        };
+    }
+}
+
+static void lava_render(void *state, const animation_config_t *config, const animation_span_t *span,
+                        const animation_clock_t *clock)
+{
+    // Lava - slow glowing blobs that rise from the start of the span
+    uint16_t *noise = span->scratch;
+    led_noise16_fill(noise, span->num_leds, -noise_time(clock, NOISE_LAVA_DRIFT), 65536 / NOISE_LAVA_LEDS,
+                     noise_time(clock, NOISE_LAVA_CHANGE), 0, 2);
+    for (uint32_t i = 0; i < span->num_leds; i++) {
+        span->pixels[i] = span->palette[noise_index(noise[i])];
+    }
+}
+
+const animation_effect_def_t animation_effects[ANIMATION_MAX] = {
+    [ANIMATION_NONE] = {
+        .info = { "off", "Off", 0 },
+        .render = off_render,
+    },
+    [ANIMATION_RAINBOW] = {
+        .info = { "rainbow", "Rainbow", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_PALETTE },
+        .continuous = true,
+        .palette = LED_PALETTE_RAINBOW,
+        .period = rainbow_period,
+        .render = rainbow_render,
+    },
+    [ANIMATION_BREATHING] = {
+        .info = { "breathing", "Breathing", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_COLOR },
+        .continuous = true,
+        .period = breathing_period,
+        .render = breathing_render,
+    },
+    [ANIMATION_CHASE] = {
+        .info = { "chase", "Chase", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_COLOR },
+        .period = chase_period,
+        .render = chase_render,
+    },
+    [ANIMATION_FIRE] = {
+        .info = { "fire", "Fire", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_PALETTE },
+        .state_size = sizeof(random_state_t),
+        .led_state_size = 1,
+        .palette = LED_PALETTE_HEAT,
+        .init = random_init,
+        .render = fire_render,
+    },
+    [ANIMATION_LIGHTNING] = {
+        .info = { "lightning", "Lightning", ANIMATION_PARAM_SPEED },
+        .state_size = sizeof(lightning_state_t),
+        .led_state_size = 1,
+        .continuous = true,
+        .init = lightning_init,
+        .render = lightning_render,
+    },
+    [ANIMATION_OCEAN] = {
+        .info = { "ocean", "Ocean", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_PALETTE },
+        .continuous = true,
+        .palette = LED_PALETTE_OCEAN,
+        .render = ocean_render,
+    },
+    [ANIMATION_AURORA] = {
+        .info = { "aurora", "Aurora", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_PALETTE },
+        .continuous = true,
+        .palette = LED_PALETTE_AURORA,
+        .render = aurora_render,
+    },
+    [ANIMATION_SOLID_COLOR] = {
+        .info = { "solid", "Solid Color", ANIMATION_PARAM_COLOR },
+        .period = static_period,
+        .render = solid_render,
+    },
+    [ANIMATION_OCEAN_NOISE] = {
+        .info = { "ocean_noise", "Ocean Noise", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_PALETTE },
+        .continuous = true,
+        .palette = LED_PALETTE_OCEAN,
+        .render = ocean_noise_render,
+    },
+    [ANIMATION_AURORA_NOISE] = {
+        .info = { "aurora_noise", "Aurora Noise", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_PALETTE },
+        .led_state_size = 1,
+        .continuous = true,
+        .palette = LED_PALETTE_AURORA,
+        .render = aurora_noise_render,
+    },
+    [ANIMATION_LAVA] = {
+        .info = { "lava", "Lava", ANIMATION_PARAM_SPEED | ANIMATION_PARAM_PALETTE },
+        .continuous = true,
+        .palette = LED_PALETTE_LAVA,
+        .render = lava_render,
+    },
+};
+
+const animation_effect_info_t *animation_get_effect_info(animation_type_t type)
+{
+    return type < ANIMATION_MAX ? &animation_effects[type].info : NULL;
+}
+
+animation_type_t animation_type_from_name(const char *name)
+{
+    for (int i = 0; i < ANIMATION_MAX; i++) {
+        if (name && strcmp(name, animation_effects[i].info.name) == 0) {
+            return i;
+        }
+    }
+    return ANIMATION_MAX;
+}
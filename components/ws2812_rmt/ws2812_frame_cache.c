@@ -0,0 +1,54 @@
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "ws2812_config.h"
+#include "ws2812_frame_cache.h"
+
+static const char *TAG = "led_frame_cache";
+
+esp_err_t animation_cache_init(animation_cache_t *cache, size_t frame_size)
+{
+    *cache = (animation_cache_t){ .frame_size = frame_size };
+    size_t capacity = ANIMATION_FRAME_CACHE_SIZE;
+    cache->memory = heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!cache->memory && ANIMATION_FRAME_CACHE_INTERNAL_SIZE > 0) {
+        capacity = ANIMATION_FRAME_CACHE_INTERNAL_SIZE;
+        cache->memory = heap_caps_malloc(capacity, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!cache->memory || frame_size == 0) {
+        ESP_LOGI(TAG, "No frame cache, animations render live");
+        animation_cache_free(cache);
+        return ESP_OK;
+    }
+    cache->capacity = capacity;
+    ESP_LOGI(TAG, "%u byte frame cache, up to %u frames", (unsigned)capacity, (unsigned)(capacity / frame_size));
+    return ESP_OK;
+}
+
+void animation_cache_free(animation_cache_t *cache)
+{
+    heap_caps_free(cache->memory);
+    cache->memory = NULL;
+    cache->capacity = 0;
+    cache->period = 0;
+    cache->filled = 0;
+}
+
+bool animation_cache_start(animation_cache_t *cache, uint32_t period)
+{
+    cache->filled = 0;
+    if (period == 0 || !cache->memory || period > cache->capacity / cache->frame_size) {
+        cache->period = 0;
+        return false;
+    }
+    cache->period = period;
+    return true;
+}
+
+uint8_t *animation_cache_next(animation_cache_t *cache, uint32_t *index)
+{
+    if (cache->filled >= cache->period) {
+        return NULL;
+    }
+    *index = cache->filled++;
+    return cache->memory + *index * cache->frame_size;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Wire-ready frames of one cycle of a periodic animation
+ *
+ * Frame i of the cycle is stored at i * frame_size. Frames are filled in
+ * order, so the cycle can be played back once filled reaches period.
+ */
+typedef struct {
+    uint8_t *memory;           /*!< Frame storage, NULL if the cache is disabled */
+    size_t capacity;           /*!< Bytes of frame storage */
+    size_t frame_size;         /*!< Bytes of one frame */
+    uint32_t period;           /*!< Frames in the cycle being cached, 0 if none */
+    uint32_t filled;           /*!< Frames of the cycle filled so far */
+} animation_cache_t;
+
+/**
+ * @brief Allocate the frame storage, in PSRAM if there is any
+ *
+ * Without PSRAM only ANIMATION_FRAME_CACHE_INTERNAL_SIZE bytes of internal
+ * RAM are used, and without any storage every animation renders live.
+ * Neither is an error.
+ *
+ * @param cache Cache to set up
+ * @param frame_size Bytes of one frame
+ * @return esp_err_t ESP_OK, also when there is no storage
+ */
+esp_err_t animation_cache_init(animation_cache_t *cache, size_t frame_size);
+
+/**
+ * @brief Free the frame storage
+ */
+void animation_cache_free(animation_cache_t *cache);
+
+/**
+ * @brief Drop the cached frames and start caching a new cycle
+ *
+ * @param cache Cache
+ * @param period Frames in the cycle, 0 to only drop the cached frames
+ * @return true if the cycle fits the storage, false if it has to render live
+ */
+bool animation_cache_start(animation_cache_t *cache, uint32_t period);
+
+/**
+ * @brief Get the next frame of the cycle to fill
+ *
+ * The frame counts as filled when this returns, so it has to be filled
+ * before the cache is read.
+ *
+ * @param cache Cache
+ * @param[out] index Index of the frame in the cycle
+ * @return uint8_t* Frame to fill, NULL once the whole cycle is cached
+ */
+uint8_t *animation_cache_next(animation_cache_t *cache, uint32_t *index);
+
+/**
+ * @brief Check whether the whole cycle is cached
+ */
+static inline bool animation_cache_ready(const animation_cache_t *cache)
+{
+    return cache->period > 0 && cache->filled == cache->period;
+}
+
+/**
+ * @brief Get a frame of a fully cached cycle
+ *
+ * @param cache Cache, animation_cache_ready() must be true
+ * @param index Index of the frame in the cycle, wraps around the period
+ * @return const uint8_t* Frame
+ */
+static inline const uint8_t *animation_cache_frame(const animation_cache_t *cache, uint64_t index)
+{
+    return cache->memory + (index % cache->period) * cache->frame_size;
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,157 @@
+#include <string.h>
+#include "ws2812_noise.h"
+
+// Value noise: every lattice point gets a hashed 16-bit value, and the
+// noise between points is interpolated with a smoothstep. A point is
+// interpolated along y and z first, into a value per lattice column in x,
+// and then along x. A fill along x keeps the two columns it is between, so
+// it only hashes when it crosses into the next cell.
+
+#define NOISE_FILL_CHUNK    64 // values per led_noise16_fill() call of led_noise8_fill()
+
+// The lattice wraps after 65536 cells, so coordinates never overflow
+static inline uint32_t noise_hash(uint32_t xi, uint32_t yi, uint32_t zi, uint32_t octave)
+{
+    uint32_t h = (xi & 0xFFFF) * 0x8DA6B343 ^ (yi & 0xFFFF) * 0xD8163841 ^ (zi & 0xFFFF) * 0xCB1AB31F ^
+                 (octave + 1) * 0x9E3779B9;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6D;
+    h ^= h >> 12;
+    h *= 0x297A2D39;
+    h ^= h >> 15;
+    return h >> 16;
+}
+
+// 3t^2 - 2t^3 in Q16, with t^2 in Q15 so the product fits 32 bits
+static inline uint32_t noise_fade(uint32_t t)
+{
+    uint32_t t2 = (t * t) >> 17;
+    return (t2 * (98304 - t)) >> 14;
+}
+
+// a + (b - a) * s, s in Q16, never outside a..b
+static inline uint32_t noise_lerp(uint32_t a, uint32_t b, uint32_t s)
+{
+    return a + (((int32_t)(b - a) * (int32_t)(s >> 1)) >> 15);
+}
+
+// Value of lattice column xi at a point of the y-z plane, with the hashes
+// a zero fraction does not need left out
+static inline uint32_t noise_column(uint32_t xi, uint32_t yi, uint32_t zi, uint32_t fy, uint32_t fz,
+                                    uint32_t octave)
+{
+    uint32_t near = noise_hash(xi, yi, zi, octave);
+    if (fy) {
+        near = noise_lerp(near, noise_hash(xi, yi + 1, zi, octave), fy);
+    }
+    if (fz) {
+        uint32_t far = noise_hash(xi, yi, zi + 1, octave);
+        if (fy) {
+            far = noise_lerp(far, noise_hash(xi, yi + 1, zi + 1, octave), fy);
+        }
+        near = noise_lerp(near, far, fz);
+    }
+    return near;
+}
+
+static uint32_t noise_point(uint32_t x, uint32_t y, uint32_t z, uint32_t octave)
+{
+    uint32_t fy = noise_fade(y & 0xFFFF);
+    uint32_t fz = noise_fade(z & 0xFFFF);
+    uint32_t fx = noise_fade(x & 0xFFFF);
+    uint32_t a = noise_column(x >> 16, y >> 16, z >> 16, fy, fz, octave);
+    if (fx == 0) {
+        return a;
+    }
+    uint32_t b = noise_column((x >> 16) + 1, y >> 16, z >> 16, fy, fz, octave);
+    return noise_lerp(a, b, fx);
+}
+
+static uint32_t noise_octaves_clamp(uint32_t octaves)
+{
+    return octaves < 1 ? 1 : octaves > LED_NOISE_MAX_OCTAVES ? LED_NOISE_MAX_OCTAVES : octaves;
+}
+
+// Weight of an octave in Q16, half of the one before, all of them adding
+// up to at most 1
+static inline uint32_t noise_weight(uint32_t octave, uint32_t octaves)
+{
+    return (65536u << (octaves - 1 - octave)) / ((1u << octaves) - 1);
+}
+
+uint16_t led_noise16_3d(uint32_t x, uint32_t y, uint32_t z)
+{
+    return noise_point(x, y, z, 0);
+}
+
+uint16_t led_noise16_2d(uint32_t x, uint32_t y)
+{
+    return noise_point(x, y, 0, 0);
+}
+
+uint16_t led_noise16_1d(uint32_t x)
+{
+    return noise_point(x, 0, 0, 0);
+}
+
+uint16_t led_noise16_octaves(uint32_t x, uint32_t y, uint32_t z, uint32_t octaves)
+{
+    octaves = noise_octaves_clamp(octaves);
+    uint32_t sum = 0;
+    for (uint32_t octave = 0; octave < octaves; octave++) {
+        uint32_t value = noise_point(x << octave, y << octave, z << octave, octave);
+        sum += (value * noise_weight(octave, octaves)) >> 16;
+    }
+    return sum;
+}
+
+// Add one octave along a line in x to dst
+static void noise_row(uint16_t *dst, size_t count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z,
+                      uint32_t octave, uint32_t weight)
+{
+    uint32_t yi = y >> 16;
+    uint32_t zi = z >> 16;
+    uint32_t fy = noise_fade(y & 0xFFFF);
+    uint32_t fz = noise_fade(z & 0xFFFF);
+    uint32_t xi = x >> 16;
+    uint32_t a = noise_column(xi, yi, zi, fy, fz, octave);
+    uint32_t b = noise_column(xi + 1, yi, zi, fy, fz, octave);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t cell = x >> 16;
+        if (cell != xi) {
+            // Usually the next cell, whose left column is known already
+            a = cell == xi + 1 ? b : noise_column(cell, yi, zi, fy, fz, octave);
+            b = noise_column(cell + 1, yi, zi, fy, fz, octave);
+            xi = cell;
+        }
+        dst[i] += (noise_lerp(a, b, noise_fade(x & 0xFFFF)) * weight) >> 16;
+        x += dx;
+    }
+}
+
+void led_noise16_fill(uint16_t *dst, size_t count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z,
+                      uint32_t octaves)
+{
+    octaves = noise_octaves_clamp(octaves);
+    memset(dst, 0, count * sizeof(uint16_t));
+    for (uint32_t octave = 0; octave < octaves; octave++) {
+        noise_row(dst, count, x << octave, dx << octave, y << octave, z << octave, octave,
+                  noise_weight(octave, octaves));
+    }
+}
+
+void led_noise8_fill(uint8_t *dst, size_t count, uint32_t x, uint32_t dx, uint32_t y, uint32_t z,
+                     uint32_t octaves)
+{
+    uint16_t chunk[NOISE_FILL_CHUNK];
+    while (count > 0) {
+        size_t n = count < NOISE_FILL_CHUNK ? count : NOISE_FILL_CHUNK;
+        led_noise16_fill(chunk, n, x, dx, y, z, octaves);
+        for (size_t i = 0; i < n; i++) {
+            dst[i] = chunk[i] >> 8;
+        }
+        dst += n;
+        count -= n;
+        x += n * dx;
+    }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "ws2812_timing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Frame done callback
+ *
+ * Called from ISR context once for every submitted frame, in submission order.
+ *
+ * @param user_ctx User context passed in the output configuration
+ * @return true if a higher priority task was woken up
+ */
+typedef bool (*led_output_done_cb_t)(void *user_ctx);
+
+typedef struct led_output_t led_output_t;
+
+/**
+ * @brief LED output backend interface
+ *
+ * A backend sends one segment of the frame, in wire byte order, on one data
+ * line. It is created by its led_output_new_*() factory.
+ */
+struct led_output_t {
+    /**
+     * @brief Queue a frame segment for transmission without waiting for it
+     *
+     * The data must stay untouched until the done callback reports the frame.
+     */
+    esp_err_t (*submit)(led_output_t *output, const uint8_t *data, size_t size);
+
+    /**
+     * @brief Wait until every submitted frame has been sent
+     */
+    esp_err_t (*wait_done)(led_output_t *output, int timeout_ms);
+
+    /**
+     * @brief Stop the output and free its resources
+     */
+    esp_err_t (*del)(led_output_t *output);
+};
+
+/**
+ * @brief LED output backend configuration
+ */
+typedef struct {
+    int gpio_num;                  /*!< GPIO number for the data line */
+    size_t max_size;               /*!< Largest segment that will be submitted, in bytes */
+    uint32_t trans_queue_depth;    /*!< Number of frames that can be queued */
+    const led_timing_t *timing;    /*!< Bit timing of the chips on the data line */
+    led_output_done_cb_t on_done;  /*!< Frame done callback */
+    void *user_ctx;                /*!< User context for on_done */
+    struct {
+        uint32_t resolution_hz;    /*!< RMT resolution in Hz */
+        uint32_t mem_block_symbols;/*!< Number of RMT memory block symbols */
+    } rmt;                         /*!< RMT backend settings */
+    struct {
+        int host;                  /*!< SPI host (spi_host_device_t) */
+    } spi;                         /*!< SPI backend settings */
+} led_output_config_t;
+
+/**
+ * @brief Create an output on an RMT TX channel
+ *
+ * @param config Output configuration
+ * @param[out] ret_output Returned output
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t led_output_new_rmt(const led_output_config_t *config, led_output_t **ret_output);
+
+/**
+ * @brief Create an output on an SPI host, driving only MOSI
+ *
+ * Every frame is encoded into one DMA buffer up front, so no CPU work is
+ * needed while it is on the wire.
+ *
+ * @param config Output configuration
+ * @param[out] ret_output Returned output
+ * @return esp_err_t ESP_OK on success, error code otherwise
+ */
+esp_err_t led_output_new_spi(const led_output_config_t *config, led_output_t **ret_output);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,295 @@
+#include <string.h>
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "driver/rmt_tx.h"
+#include "ws2812_control.h"
+#include "ws2812_output.h"
+#include "ws2812_rmt_encode.h"
+
+static const char *TAG = "led_encoder";
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *copy_encoder;
+    int state;
+    rmt_symbol_word_t reset_code;
+} rmt_led_strip_encoder_t;
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_t *simple_encoder;
+    led_rmt_table_t table;
+} rmt_led_strip_table_encoder_t;
+
+_Static_assert(sizeof(rmt_symbol_word_t) == sizeof(uint32_t), "symbols are written as raw words");
+
+typedef struct {
+    led_output_t base;
+    rmt_channel_handle_t chan;
+    rmt_encoder_handle_t encoder;
+    led_output_done_cb_t on_done;
+    void *user_ctx;
+    bool enabled;
+} led_output_rmt_t;
+
+static bool rmt_led_strip_timing_ticks(const led_strip_encoder_config_t *config, led_timing_ticks_t *ticks)
+{
+    const led_timing_t *timing = config->timing ? config->timing : led_timing_get(LED_TIMING_WS2812B);
+    return led_timing_to_ticks(timing, config->resolution, ticks);
+}
+
+static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    rmt_encoder_handle_t bytes_encoder = led_encoder->bytes_encoder;
+    rmt_encoder_handle_t copy_encoder = led_encoder->copy_encoder;
+    rmt_encode_state_t session_state = RMT_ENCODING_RESET;
+    rmt_encode_state_t state = RMT_ENCODING_RESET;
+    size_t encoded_symbols = 0;
+    switch (led_encoder->state) {
+    case 0: // send RGB data
+        encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            led_encoder->state = 1; // switch to next state when current encoding session finished
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out; // yield if there's no free space for encoding artifacts
+        }
+    // fall-through
+    case 1: // send reset code
+        encoded_symbols += copy_encoder->encode(copy_encoder, channel, &led_encoder->reset_code,
+                                                sizeof(led_encoder->reset_code), &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            led_encoder->state = RMT_ENCODING_RESET; // back to the initial encoding session
+            state |= RMT_ENCODING_COMPLETE;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out; // yield if there's no free space for encoding artifacts
+        }
+    }
+out:
+    *ret_state = state;
+    return encoded_symbols;
+}
+
+static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    rmt_del_encoder(led_encoder->bytes_encoder);
+    rmt_del_encoder(led_encoder->copy_encoder);
+    free(led_encoder);
+    return ESP_OK;
+}
+
+static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    rmt_encoder_reset(led_encoder->bytes_encoder);
+    rmt_encoder_reset(led_encoder->copy_encoder);
+    led_encoder->state = RMT_ENCODING_RESET;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    led_encoder = rmt_alloc_encoder_mem(sizeof(rmt_led_strip_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    led_encoder->base.encode = rmt_encode_led_strip;
+    led_encoder->base.del = rmt_del_led_strip_encoder;
+    led_encoder->base.reset = rmt_led_strip_encoder_reset;
+    led_timing_ticks_t ticks;
+    ESP_GOTO_ON_FALSE(rmt_led_strip_timing_ticks(config, &ticks), ESP_ERR_INVALID_ARG, err, TAG, "timing does not fit the resolution");
+    rmt_bytes_encoder_config_t bytes_encoder_config = {
+        .bit0 = {
+            .level0 = 1,
+            .duration0 = ticks.t0h,
+            .level1 = 0,
+            .duration1 = ticks.t0l,
+        },
+        .bit1 = {
+            .level0 = 1,
+            .duration0 = ticks.t1h,
+            .level1 = 0,
+            .duration1 = ticks.t1l,
+        },
+        .flags.msb_first = 1 // WS2812 transfer bit order: G7...G0R7...R0B7...B0
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create bytes encoder failed");
+    rmt_copy_encoder_config_t copy_encoder_config = {};
+    ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder), err, TAG, "create copy encoder failed");
+
+    led_encoder->reset_code = (rmt_symbol_word_t) {
+        .level0 = 0,
+        .duration0 = ticks.reset_half,
+        .level1 = 0,
+        .duration1 = ticks.reset_half,
+    };
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    if (led_encoder) {
+        if (led_encoder->bytes_encoder) {
+            rmt_del_encoder(led_encoder->bytes_encoder);
+        }
+        if (led_encoder->copy_encoder) {
+            rmt_del_encoder(led_encoder->copy_encoder);
+        }
+        free(led_encoder);
+    }
+    return ret;
+}
+
+static size_t IRAM_ATTR rmt_encode_led_strip_table(const void *data, size_t data_size, size_t symbols_written, size_t symbols_free,
+                                                   rmt_symbol_word_t *symbols, bool *done, void *arg)
+{
+    rmt_led_strip_table_encoder_t *led_encoder = arg;
+    return led_rmt_table_encode(&led_encoder->table, data, data_size, symbols_written, symbols_free,
+                                (uint32_t *)symbols, done);
+}
+
+static size_t rmt_encode_led_strip_table_forward(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_led_strip_table_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_table_encoder_t, base);
+    return led_encoder->simple_encoder->encode(led_encoder->simple_encoder, channel, primary_data, data_size, ret_state);
+}
+
+static esp_err_t rmt_del_led_strip_table_encoder(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_table_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_table_encoder_t, base);
+    rmt_del_encoder(led_encoder->simple_encoder);
+    free(led_encoder);
+    return ESP_OK;
+}
+
+static esp_err_t rmt_led_strip_table_encoder_reset(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_table_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_table_encoder_t, base);
+    return rmt_encoder_reset(led_encoder->simple_encoder);
+}
+
+esp_err_t rmt_new_led_strip_table_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_table_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    // allocated like any encoder so the table is reachable from the RMT ISR
+    led_encoder = rmt_alloc_encoder_mem(sizeof(rmt_led_strip_table_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip table encoder");
+    led_encoder->base.encode = rmt_encode_led_strip_table_forward;
+    led_encoder->base.del = rmt_del_led_strip_table_encoder;
+    led_encoder->base.reset = rmt_led_strip_table_encoder_reset;
+
+    // same timing as rmt_new_led_strip_encoder(), expanded once for all 256 byte values
+    led_timing_ticks_t ticks;
+    ESP_GOTO_ON_FALSE(rmt_led_strip_timing_ticks(config, &ticks), ESP_ERR_INVALID_ARG, err, TAG, "timing does not fit the resolution");
+    led_rmt_table_build(&led_encoder->table, &ticks);
+
+    rmt_simple_encoder_config_t simple_encoder_config = {
+        .callback = rmt_encode_led_strip_table,
+        .arg = led_encoder,
+        .min_chunk_size = 8, // one byte, so the callback can always make progress
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_simple_encoder(&simple_encoder_config, &led_encoder->simple_encoder), err, TAG, "create simple encoder failed");
+
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    if (led_encoder) {
+        free(led_encoder);
+    }
+    return ret;
+}
+
+static bool IRAM_ATTR led_output_rmt_trans_done(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_output_rmt_t *rmt_output = user_ctx;
+    return rmt_output->on_done(rmt_output->user_ctx);
+}
+
+static esp_err_t led_output_rmt_submit(led_output_t *output, const uint8_t *data, size_t size)
+{
+    led_output_rmt_t *rmt_output = __containerof(output, led_output_rmt_t, base);
+    rmt_transmit_config_t tx_config = {
+        .loop_count = 0, // no transfer loop
+    };
+    return rmt_transmit(rmt_output->chan, rmt_output->encoder, data, size, &tx_config);
+}
+
+static esp_err_t led_output_rmt_wait_done(led_output_t *output, int timeout_ms)
+{
+    led_output_rmt_t *rmt_output = __containerof(output, led_output_rmt_t, base);
+    return rmt_tx_wait_all_done(rmt_output->chan, timeout_ms);
+}
+
+static esp_err_t led_output_rmt_del(led_output_t *output)
+{
+    led_output_rmt_t *rmt_output = __containerof(output, led_output_rmt_t, base);
+    if (rmt_output->enabled) {
+        rmt_disable(rmt_output->chan);
+    }
+    if (rmt_output->chan) {
+        rmt_del_channel(rmt_output->chan);
+    }
+    if (rmt_output->encoder) {
+        rmt_del_encoder(rmt_output->encoder);
+    }
+    free(rmt_output);
+    return ESP_OK;
+}
+
+esp_err_t led_output_new_rmt(const led_output_config_t *config, led_output_t **ret_output)
+{
+    esp_err_t ret = ESP_OK;
+    led_output_rmt_t *rmt_output = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_output && config->on_done, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    rmt_output = calloc(1, sizeof(led_output_rmt_t));
+    ESP_GOTO_ON_FALSE(rmt_output, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt output");
+    rmt_output->base.submit = led_output_rmt_submit;
+    rmt_output->base.wait_done = led_output_rmt_wait_done;
+    rmt_output->base.del = led_output_rmt_del;
+    rmt_output->on_done = config->on_done;
+    rmt_output->user_ctx = config->user_ctx;
+
+    rmt_tx_channel_config_t tx_chan_config = {
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .gpio_num = config->gpio_num,
+        .mem_block_symbols = config->rmt.mem_block_symbols,
+        .resolution_hz = config->rmt.resolution_hz,
+        .trans_queue_depth = config->trans_queue_depth,
+    };
+    ESP_LOGI(TAG, "Create RMT TX channel on GPIO %d with %s timing", config->gpio_num, config->timing ? config->timing->name : "ws2812b");
+    ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&tx_chan_config, &rmt_output->chan), err, TAG, "create RMT TX channel failed");
+
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = led_output_rmt_trans_done,
+    };
+    ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_output->chan, &cbs, rmt_output), err, TAG, "register callbacks failed");
+
+    // the encoder keeps per-transaction state, so every channel gets its own
+    led_strip_encoder_config_t encoder_config = {
+        .resolution = config->rmt.resolution_hz,
+        .timing = config->timing,
+    };
+#if RMT_LED_STRIP_TABLE_ENCODER
+    ESP_GOTO_ON_ERROR(rmt_new_led_strip_table_encoder(&encoder_config, &rmt_output->encoder), err, TAG, "install led strip encoder failed");
+#else
+    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&encoder_config, &rmt_output->encoder), err, TAG, "install led strip encoder failed");
+#endif
+
+    ESP_GOTO_ON_ERROR(rmt_enable(rmt_output->chan), err, TAG, "enable RMT TX channel failed");
+    rmt_output->enabled = true;
+
+    *ret_output = &rmt_output->base;
+    return ESP_OK;
+err:
+    if (rmt_output) {
+        led_output_rmt_del(&rmt_output->base);
+    }
+    return ret;
+}
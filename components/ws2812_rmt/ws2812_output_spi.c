@@ -0,0 +1,164 @@
+#include <string.h>
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "driver/spi_master.h"
+#include "freertos/FreeRTOS.h"
+#include "ws2812_config.h"
+#include "ws2812_output.h"
+#include "ws2812_spi_encode.h"
+
+static const char *TAG = "led_spi";
+
+typedef struct {
+    led_output_t base;
+    spi_host_device_t host;
+    spi_device_handle_t dev;
+    bool bus_initialized;
+    uint8_t *dma_buffers[RMT_LED_STRIP_FRAME_BUFFERS]; // one encoded frame each, used round-robin
+    spi_transaction_t trans[RMT_LED_STRIP_FRAME_BUFFERS];
+    int next;                  // next DMA buffer to encode into
+    uint32_t inflight;         // queued transactions whose result was not fetched yet
+    size_t reset_bytes;        // low bytes appended to latch the frame
+    led_spi_code_t code;       // SPI bits of every data bit, chosen for the timing
+    led_output_done_cb_t on_done;
+    void *user_ctx;
+} led_output_spi_t;
+
+static void IRAM_ATTR led_output_spi_post_cb(spi_transaction_t *trans)
+{
+    led_output_spi_t *spi_output = trans->user;
+    if (spi_output->on_done(spi_output->user_ctx)) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static esp_err_t led_output_spi_collect(led_output_spi_t *spi_output, TickType_t ticks)
+{
+    spi_transaction_t *done = NULL;
+    esp_err_t ret = spi_device_get_trans_result(spi_output->dev, &done, ticks);
+    if (ret == ESP_OK) {
+        spi_output->inflight--;
+    }
+    return ret;
+}
+
+static esp_err_t led_output_spi_submit(led_output_t *output, const uint8_t *data, size_t size)
+{
+    led_output_spi_t *spi_output = __containerof(output, led_output_spi_t, base);
+
+    // Fetch finished transactions so the driver's result queue never fills up.
+    // Completion itself is reported from the post callback.
+    while (spi_output->inflight && led_output_spi_collect(spi_output, 0) == ESP_OK) {
+    }
+
+    // The buffer was last used RMT_LED_STRIP_FRAME_BUFFERS frames ago, and the
+    // caller only reuses a frame slot after it has been reported done
+    uint8_t *buffer = spi_output->dma_buffers[spi_output->next];
+    size_t encoded = led_spi_encode(data, size, buffer, &spi_output->code);
+    memset(buffer + encoded, 0, spi_output->reset_bytes);
+
+    spi_transaction_t *trans = &spi_output->trans[spi_output->next];
+    memset(trans, 0, sizeof(spi_transaction_t));
+    trans->length = (encoded + spi_output->reset_bytes) * 8;
+    trans->tx_buffer = buffer;
+    trans->user = spi_output;
+
+    esp_err_t ret = spi_device_queue_trans(spi_output->dev, trans, portMAX_DELAY);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    spi_output->inflight++;
+    spi_output->next = (spi_output->next + 1) % RMT_LED_STRIP_FRAME_BUFFERS;
+    return ESP_OK;
+}
+
+static esp_err_t led_output_spi_wait_done(led_output_t *output, int timeout_ms)
+{
+    led_output_spi_t *spi_output = __containerof(output, led_output_spi_t, base);
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    while (spi_output->inflight) {
+        if (led_output_spi_collect(spi_output, ticks) != ESP_OK) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t led_output_spi_del(led_output_t *output)
+{
+    led_output_spi_t *spi_output = __containerof(output, led_output_spi_t, base);
+    if (spi_output->dev) {
+        led_output_spi_wait_done(output, -1);
+        spi_bus_remove_device(spi_output->dev);
+    }
+    if (spi_output->bus_initialized) {
+        spi_bus_free(spi_output->host);
+    }
+    for (int i = 0; i < RMT_LED_STRIP_FRAME_BUFFERS; i++) {
+        heap_caps_free(spi_output->dma_buffers[i]);
+    }
+    free(spi_output);
+    return ESP_OK;
+}
+
+esp_err_t led_output_new_spi(const led_output_config_t *config, led_output_t **ret_output)
+{
+    esp_err_t ret = ESP_OK;
+    led_output_spi_t *spi_output = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_output && config->on_done, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->trans_queue_depth >= RMT_LED_STRIP_FRAME_BUFFERS, ESP_ERR_INVALID_ARG, err, TAG, "trans queue too short");
+    spi_output = calloc(1, sizeof(led_output_spi_t));
+    ESP_GOTO_ON_FALSE(spi_output, ESP_ERR_NO_MEM, err, TAG, "no mem for spi output");
+    spi_output->base.submit = led_output_spi_submit;
+    spi_output->base.wait_done = led_output_spi_wait_done;
+    spi_output->base.del = led_output_spi_del;
+    spi_output->host = config->spi.host;
+    spi_output->on_done = config->on_done;
+    spi_output->user_ctx = config->user_ctx;
+
+    // High and low times are whole SPI clocks, a timing that no code of 3 or
+    // 4 clocks per data bit matches would put out-of-spec pulses on the wire
+    const led_timing_t *timing = config->timing ? config->timing : led_timing_get(LED_TIMING_WS2812B);
+    uint32_t clock_hz = 0;
+    ESP_GOTO_ON_FALSE(led_spi_code_for_timing(timing, LED_STRIP_SPI_TOLERANCE_NS, &spi_output->code, &clock_hz),
+                      ESP_ERR_NOT_SUPPORTED, err, TAG, "%s timing does not fit an SPI clock", timing->name);
+    spi_output->reset_bytes = (size_t)timing->reset_us * clock_hz / 8000000 + 1;
+    size_t buffer_size = led_spi_encoded_size(config->max_size, &spi_output->code) + spi_output->reset_bytes;
+    for (int i = 0; i < RMT_LED_STRIP_FRAME_BUFFERS; i++) {
+        spi_output->dma_buffers[i] = heap_caps_malloc(buffer_size, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        ESP_GOTO_ON_FALSE(spi_output->dma_buffers[i], ESP_ERR_NO_MEM, err, TAG, "no mem for %u byte DMA buffer", (unsigned)buffer_size);
+    }
+
+    spi_bus_config_t bus_config = {
+        .mosi_io_num = config->gpio_num,
+        .miso_io_num = -1,
+        .sclk_io_num = -1,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = buffer_size,
+        .flags = SPICOMMON_BUSFLAG_MASTER,
+    };
+    ESP_LOGI(TAG, "Initialize SPI host %d on GPIO %d at %lu Hz, %d bits per bit", config->spi.host, config->gpio_num,
+             (unsigned long)clock_hz, spi_output->code.bits_per_bit);
+    ESP_GOTO_ON_ERROR(spi_bus_initialize(spi_output->host, &bus_config, SPI_DMA_CH_AUTO), err, TAG, "initialize SPI bus failed");
+    spi_output->bus_initialized = true;
+
+    spi_device_interface_config_t dev_config = {
+        .mode = 0,
+        .clock_speed_hz = clock_hz,
+        .spics_io_num = -1,
+        .queue_size = config->trans_queue_depth,
+        .flags = SPI_DEVICE_NO_DUMMY,
+        .post_cb = led_output_spi_post_cb,
+    };
+    ESP_GOTO_ON_ERROR(spi_bus_add_device(spi_output->host, &dev_config, &spi_output->dev), err, TAG, "add SPI device failed");
+
+    *ret_output = &spi_output->base;
+    return ESP_OK;
+err:
+    if (spi_output) {
+        led_output_spi_del(&spi_output->base);
+    }
+    return ret;
+}
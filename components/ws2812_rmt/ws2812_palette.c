@@ -0,0 +1,160 @@
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "ws2812_palette.h"
+
+// Every palette and its color table. Built-in entries are never written;
+// uploaded ones are written under palette_lock and marked stale until the
+// render task rebuilds their tables.
+static led_palette_t palettes[LED_PALETTE_MAX] = {
+    [LED_PALETTE_RAINBOW] = { "rainbow", 9, {
+        { 0, 255, 0, 0 }, { 32, 171, 85, 0 }, { 64, 171, 170, 0 }, { 96, 0, 255, 0 }, { 128, 0, 171, 85 },
+        { 160, 0, 0, 255 }, { 192, 85, 0, 171 }, { 224, 170, 0, 85 }, { 255, 252, 0, 3 } } },
+    [LED_PALETTE_HEAT] = { "heat", 4, {
+        { 0, 0, 0, 0 }, { 80, 255, 0, 0 }, { 160, 255, 255, 0 }, { 240, 255, 255, 255 } } },
+    [LED_PALETTE_OCEAN] = { "ocean", 2, {
+        { 0, 0, 50, 100 }, { 255, 0, 100, 200 } } },
+    [LED_PALETTE_AURORA] = { "aurora", 4, {
+        { 0, 0, 255, 80 }, { 96, 0, 200, 160 }, { 176, 80, 40, 220 }, { 255, 150, 0, 180 } } },
+    [LED_PALETTE_LAVA] = { "lava", 5, {
+        { 0, 0, 0, 0 }, { 70, 120, 0, 0 }, { 140, 255, 40, 0 }, { 200, 255, 120, 0 }, { 255, 255, 220, 120 } } },
+    [LED_PALETTE_FOREST] = { "forest", 4, {
+        { 0, 0, 40, 0 }, { 100, 20, 120, 10 }, { 180, 80, 160, 20 }, { 255, 160, 200, 60 } } },
+};
+static led_color_t luts[LED_PALETTE_MAX][256];
+static uint32_t stale = ((1u << LED_PALETTE_USER) - 1) & ~1u; // the built-in tables are built on the first update
+static portMUX_TYPE palette_lock = portMUX_INITIALIZER_UNLOCKED;
+
+_Static_assert(LED_PALETTE_MAX <= 32, "stale is a bitmask of palettes");
+
+void led_palette_build(const led_palette_t *palette, led_color_t lut[256])
+{
+    const led_palette_stop_t *stops = palette->stops;
+    const led_palette_stop_t *last = &stops[palette->num_stops - 1];
+    uint32_t i = 0;
+    for (; i < stops[0].pos; i++) {
+        lut[i] = (led_color_t){ .r = stops[0].r, .g = stops[0].g, .b = stops[0].b };
+    }
+    // One run per pair of stops, interpolated in 16.16 fixed point
+    for (const led_palette_stop_t *a = stops; a < last; a++) {
+        const led_palette_stop_t *b = a + 1;
+        uint32_t width = b->pos - a->pos;
+        if (width == 0) {
+            continue;
+        }
+        int32_t dr = (b->r - a->r) * 65536 / (int32_t)width;
+        int32_t dg = (b->g - a->g) * 65536 / (int32_t)width;
+        int32_t db = (b->b - a->b) * 65536 / (int32_t)width;
+        int32_t r = a->r * 65536 + 0x8000, g = a->g * 65536 + 0x8000, bl = a->b * 65536 + 0x8000;
+        for (; i < b->pos; i++) {
+            lut[i] = (led_color_t){ .r = r >> 16, .g = g >> 16, .b = bl >> 16 };
+            r += dr;
+            g += dg;
+            bl += db;
+        }
+    }
+    for (; i < 256; i++) {
+        lut[i] = (led_color_t){ .r = last->r, .g = last->g, .b = last->b };
+    }
+}
+
+bool led_palette_valid(const led_palette_t *palette)
+{
+    if (!palette || palette->num_stops == 0 || palette->num_stops > LED_PALETTE_MAX_STOPS ||
+        palette->name[0] == '\0' || memchr(palette->name, '\0', LED_PALETTE_NAME_LEN) == NULL) {
+        return false;
+    }
+    for (int i = 1; i < palette->num_stops; i++) {
+        if (palette->stops[i].pos < palette->stops[i - 1].pos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+led_palette_id_t led_palette_find(const char *name)
+{
+    if (!name) {
+        return LED_PALETTE_NONE;
+    }
+    led_palette_id_t found = LED_PALETTE_NONE;
+    portENTER_CRITICAL(&palette_lock);
+    for (int i = LED_PALETTE_NONE + 1; i < LED_PALETTE_MAX; i++) {
+        if (palettes[i].num_stops && strcmp(name, palettes[i].name) == 0) {
+            found = i;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&palette_lock);
+    return found;
+}
+
+esp_err_t led_palette_get(led_palette_id_t id, led_palette_t *palette)
+{
+    if (id <= LED_PALETTE_NONE || id >= LED_PALETTE_MAX || !palette) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    portENTER_CRITICAL(&palette_lock);
+    *palette = palettes[id];
+    portEXIT_CRITICAL(&palette_lock);
+    return palette->num_stops ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t led_palette_set(const led_palette_t *palette, led_palette_id_t *id)
+{
+    if (!led_palette_valid(palette)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    led_palette_id_t existing = led_palette_find(palette->name);
+    if (existing != LED_PALETTE_NONE && existing < LED_PALETTE_USER) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    portENTER_CRITICAL(&palette_lock);
+    led_palette_id_t slot = existing;
+    for (int i = LED_PALETTE_USER; slot == LED_PALETTE_NONE && i < LED_PALETTE_MAX; i++) {
+        if (palettes[i].num_stops == 0) {
+            slot = i;
+        }
+    }
+    if (slot != LED_PALETTE_NONE) {
+        palettes[slot] = *palette;
+        stale |= 1u << slot;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&palette_lock);
+
+    if (id) {
+        *id = slot;
+    }
+    return ret;
+}
+
+bool led_palette_update(void)
+{
+    if (!stale) {
+        return false;
+    }
+    for (int i = LED_PALETTE_NONE + 1; i < LED_PALETTE_MAX; i++) {
+        led_palette_t palette;
+        portENTER_CRITICAL(&palette_lock);
+        bool rebuild = stale & (1u << i);
+        stale &= ~(1u << i);
+        if (rebuild) {
+            palette = palettes[i];
+        }
+        portEXIT_CRITICAL(&palette_lock);
+        if (rebuild) {
+            led_palette_build(&palette, luts[i]);
+        }
+    }
+    return true;
+}
+
+const led_color_t *led_palette_lut(led_palette_id_t id)
+{
+    if (id <= LED_PALETTE_NONE || id >= LED_PALETTE_MAX || palettes[id].num_stops == 0) {
+        return NULL;
+    }
+    return luts[id];
+}
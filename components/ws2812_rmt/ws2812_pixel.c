@@ -0,0 +1,179 @@
+#include <math.h>
+#include <string.h>
+#include "ws2812_pixel.h"
+
+// Output stage of one channel: add the error left over from the last frame
+// to the 8.8 level and keep the new fraction for the next one
+static inline uint8_t led_stage(uint32_t value, uint8_t *error)
+{
+    value += *error; // at most 0xFF00 + 0xFF
+    *error = value & 0xFF;
+    return value >> 8;
+}
+
+#define LED_LEVEL(c)        lut->c[src[i].c]
+#define LED_LEVEL_SCALED(c) ((lut->c[src[i].c] * scale) >> 8)
+#define LED_DITHER(level, c) led_stage(level(c), &dither[i].c)
+#define LED_ROUND(level, c) ((level(c) + 0x80) >> 8)
+
+#define LED_PACK_LOOP_3(out, level, c0, c1, c2) \
+    for (size_t i = 0; i < count; i++) {        \
+        dst[0] = out(level, c0);                \
+        dst[1] = out(level, c1);                \
+        dst[2] = out(level, c2);                \
+        dst += 3;                               \
+    }
+
+#define LED_PACK_LOOP_4(out, level, c0, c1, c2, c3) \
+    for (size_t i = 0; i < count; i++) {            \
+        dst[0] = out(level, c0);                    \
+        dst[1] = out(level, c1);                    \
+        dst[2] = out(level, c2);                    \
+        dst[3] = out(level, c3);                    \
+        dst += 4;                                   \
+    }
+
+// One packer per wire format, the channel order is baked in by the macro.
+// Each has a loop per combination of dithering and scaling, so the common
+// unscaled case pays for neither. Without a dither buffer every channel is
+// rounded.
+#define LED_DEFINE_PACKER(name, loop, ...)                                              \
+    static void led_pack_##name(const led_color_t *src, uint8_t *dst, size_t count,     \
+                                const led_pixel_lut_t *lut, led_color_t *dither,        \
+                                uint16_t scale)                                         \
+    {                                                                                   \
+        if (dither && scale < LED_PIXEL_SCALE_FULL) {                                   \
+            loop(LED_DITHER, LED_LEVEL_SCALED, __VA_ARGS__)                             \
+        } else if (dither) {                                                            \
+            loop(LED_DITHER, LED_LEVEL, __VA_ARGS__)                                    \
+        } else if (scale < LED_PIXEL_SCALE_FULL) {                                      \
+            loop(LED_ROUND, LED_LEVEL_SCALED, __VA_ARGS__)                              \
+        } else {                                                                        \
+            loop(LED_ROUND, LED_LEVEL, __VA_ARGS__)                                     \
+        }                                                                               \
+    }
+
+LED_DEFINE_PACKER(grb, LED_PACK_LOOP_3, g, r, b)
+LED_DEFINE_PACKER(rgb, LED_PACK_LOOP_3, r, g, b)
+LED_DEFINE_PACKER(bgr, LED_PACK_LOOP_3, b, g, r)
+LED_DEFINE_PACKER(grbw, LED_PACK_LOOP_4, g, r, b, w)
+LED_DEFINE_PACKER(rgbw, LED_PACK_LOOP_4, r, g, b, w)
+
+static const struct {
+    const char *name;
+    size_t bytes;
+    led_pixel_packer_t pack;
+} pixel_formats[LED_PIXEL_FORMAT_MAX] = {
+    [LED_PIXEL_FORMAT_GRB] = { "grb", 3, led_pack_grb },
+    [LED_PIXEL_FORMAT_RGB] = { "rgb", 3, led_pack_rgb },
+    [LED_PIXEL_FORMAT_BGR] = { "bgr", 3, led_pack_bgr },
+    [LED_PIXEL_FORMAT_GRBW] = { "grbw", 4, led_pack_grbw },
+    [LED_PIXEL_FORMAT_RGBW] = { "rgbw", 4, led_pack_rgbw },
+};
+
+static void led_pixel_lut_build_channel(uint16_t *lut, uint16_t gamma)
+{
+    float exponent = gamma ? gamma / 100.0f : 1.0f;
+    for (int level = 0; level < 256; level++) {
+        lut[level] = (uint16_t)(powf(level / 255.0f, exponent) * 0xFF00 + 0.5f);
+    }
+}
+
+void led_pixel_lut_build(led_pixel_lut_t *lut, const led_pixel_gamma_t *gamma)
+{
+    led_pixel_lut_build_channel(lut->r, gamma->r);
+    led_pixel_lut_build_channel(lut->g, gamma->g);
+    led_pixel_lut_build_channel(lut->b, gamma->b);
+    led_pixel_lut_build_channel(lut->w, gamma->w);
+}
+
+void led_pixel_lut_scale(led_pixel_lut_t *lut, const led_pixel_lut_t *base, uint8_t brightness)
+{
+    // the channel tables are contiguous, scale them in one pass
+    const uint16_t *src = base->r;
+    uint16_t *dst = lut->r;
+    for (size_t i = 0; i < sizeof(led_pixel_lut_t) / sizeof(uint16_t); i++) {
+        dst[i] = ((uint32_t)src[i] * brightness + 127) / 255;
+    }
+}
+
+// a * (b + 1) / 256, maps 255 * 255 to 255 without a division
+static inline uint8_t scale8(uint8_t a, uint8_t b)
+{
+    return (a * (b + 1)) >> 8;
+}
+
+led_color_t led_hsv2rgb(led_hsv_t hsv)
+{
+    // Eight sections of 32 hues, ramping with thirds of the section offset
+    uint8_t offset = (hsv.h & 0x1F) << 3;
+    uint8_t third = scale8(offset, 85);
+    uint8_t two_thirds = scale8(offset, 170);
+    uint8_t r, g, b;
+
+    switch (hsv.h >> 5) {
+    case 0: // red to orange
+        r = 255 - third; g = third; b = 0;
+        break;
+    case 1: // orange to yellow
+        r = 171; g = 85 + third; b = 0;
+        break;
+    case 2: // yellow to green
+        r = 171 - two_thirds; g = 170 + third; b = 0;
+        break;
+    case 3: // green to aqua
+        r = 0; g = 255 - third; b = third;
+        break;
+    case 4: // aqua to blue
+        r = 0; g = 171 - two_thirds; b = 85 + two_thirds;
+        break;
+    case 5: // blue to purple
+        r = third; g = 0; b = 255 - third;
+        break;
+    case 6: // purple to pink
+        r = 85 + third; g = 0; b = 171 - third;
+        break;
+    default: // pink to red
+        r = 170 + third; g = 0; b = 85 - third;
+        break;
+    }
+
+    // Lower saturation lifts every channel towards white
+    if (hsv.s != 255) {
+        uint8_t white = 255 - hsv.s;
+        r = scale8(r, hsv.s) + white;
+        g = scale8(g, hsv.s) + white;
+        b = scale8(b, hsv.s) + white;
+    }
+    if (hsv.v != 255) {
+        r = scale8(r, hsv.v);
+        g = scale8(g, hsv.v);
+        b = scale8(b, hsv.v);
+    }
+    return (led_color_t){ .r = r, .g = g, .b = b };
+}
+
+size_t led_pixel_format_bytes(led_pixel_format_t format)
+{
+    return format < LED_PIXEL_FORMAT_MAX ? pixel_formats[format].bytes : 0;
+}
+
+led_pixel_packer_t led_pixel_get_packer(led_pixel_format_t format)
+{
+    return format < LED_PIXEL_FORMAT_MAX ? pixel_formats[format].pack : NULL;
+}
+
+const char *led_pixel_format_name(led_pixel_format_t format)
+{
+    return format < LED_PIXEL_FORMAT_MAX ? pixel_formats[format].name : "unknown";
+}
+
+led_pixel_format_t led_pixel_format_from_name(const char *name)
+{
+    for (int i = 0; i < LED_PIXEL_FORMAT_MAX; i++) {
+        if (name && strcmp(name, pixel_formats[i].name) == 0) {
+            return i;
+        }
+    }
+    return LED_PIXEL_FORMAT_MAX;
+}
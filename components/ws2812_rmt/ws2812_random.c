@@ -0,0 +1,33 @@
+#include <string.h>
+#include "ws2812_random.h"
+
+void led_rand_seed(led_rand_t *rng, uint32_t seed)
+{
+    // Spread the seed so nearby seeds do not start out alike, xorshift
+    // gets stuck at 0
+    seed = (seed ^ 0x9E3779B9) * 0x85EBCA6B;
+    seed ^= seed >> 13;
+    rng->state = seed ? seed : 0x9E3779B9;
+}
+
+void led_rand_fill(led_rand_t *rng, uint8_t *dst, size_t size)
+{
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        uint32_t x = led_rand32(rng);
+        memcpy(dst + i, &x, 4);
+    }
+    if (i < size) {
+        uint32_t x = led_rand32(rng);
+        memcpy(dst + i, &x, size - i);
+    }
+}
+
+void led_rand_fill_range(led_rand_t *rng, uint8_t *dst, size_t size, uint8_t base, uint32_t range)
+{
+    // Random bytes scaled into the range, multiply and shift per byte
+    led_rand_fill(rng, dst, size);
+    for (size_t i = 0; i < size; i++) {
+        dst[i] = base + ((dst[i] * range) >> 8);
+    }
+}
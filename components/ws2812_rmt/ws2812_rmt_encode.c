@@ -0,0 +1,13 @@
+#include "ws2812_rmt_encode.h"
+
+void led_rmt_table_build(led_rmt_table_t *table, const led_timing_ticks_t *ticks)
+{
+    uint32_t bit0 = led_rmt_symbol(1, ticks->t0h, 0, ticks->t0l);
+    uint32_t bit1 = led_rmt_symbol(1, ticks->t1h, 0, ticks->t1l);
+    for (int value = 0; value < 256; value++) {
+        for (int bit = 0; bit < LED_RMT_SYMBOLS_PER_BYTE; bit++) {
+            table->symbols[value][bit] = (value & (0x80 >> bit)) ? bit1 : bit0;
+        }
+    }
+    table->reset = led_rmt_symbol(0, ticks->reset_half, 0, ticks->reset_half);
+}
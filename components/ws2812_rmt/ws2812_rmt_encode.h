@@ -0,0 +1,99 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ws2812_timing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Symbols every data byte expands to, one per bit
+ */
+#define LED_RMT_SYMBOLS_PER_BYTE 8
+
+/**
+ * @brief Symbols of every byte value, as raw RMT symbol words
+ *
+ * A word holds duration0 in bits 0-14, level0 in bit 15, duration1 in bits
+ * 16-30 and level1 in bit 31, the layout of rmt_symbol_word_t::val. Has no
+ * dependencies besides libc, so it also builds on the host.
+ */
+typedef struct {
+    uint32_t reset;            /*!< Reset code, low for two halves */
+    uint32_t symbols[256][LED_RMT_SYMBOLS_PER_BYTE]; /*!< Symbols of every byte value, MSB first */
+} led_rmt_table_t;
+
+/**
+ * @brief Pack one RMT symbol word
+ *
+ * @param level0 Level of the first half
+ * @param duration0 Ticks of the first half, 15 bits
+ * @param level1 Level of the second half
+ * @param duration1 Ticks of the second half, 15 bits
+ * @return uint32_t Symbol word
+ */
+static inline uint32_t led_rmt_symbol(uint32_t level0, uint32_t duration0, uint32_t level1, uint32_t duration1)
+{
+    return (duration0 & 0x7FFF) | (level0 & 1) << 15 | (duration1 & 0x7FFF) << 16 | (level1 & 1) << 31;
+}
+
+/**
+ * @brief Expand a timing into the symbols of all 256 byte values
+ *
+ * @param[out] table Table, 8 KiB
+ * @param ticks Timing in ticks of the RMT resolution
+ */
+void led_rmt_table_build(led_rmt_table_t *table, const led_timing_ticks_t *ticks);
+
+/**
+ * @brief Write the next symbols of a byte stream followed by the reset code
+ *
+ * The body of an RMT simple encoder callback. Whole bytes only, so it makes
+ * progress whenever 8 symbols are free. Inlined, so it runs from wherever its
+ * caller runs, such as IRAM.
+ *
+ * @param table Symbol table
+ * @param data Data bytes in wire order
+ * @param data_size Number of data bytes
+ * @param symbols_written Symbols written so far in this transaction
+ * @param symbols_free Room for this many symbols
+ * @param[out] symbols Symbol words
+ * @param[out] done Set once the reset code is written
+ * @return size_t Number of symbols written, 0 if there is not enough room
+ */
+__attribute__((always_inline))
+static inline size_t led_rmt_table_encode(const led_rmt_table_t *table, const uint8_t *data, size_t data_size,
+                                          size_t symbols_written, size_t symbols_free, uint32_t *symbols, bool *done)
+{
+    size_t byte = symbols_written / LED_RMT_SYMBOLS_PER_BYTE; // every data byte expands to exactly 8 symbols
+
+    if (byte < data_size) {
+        size_t count = symbols_free / LED_RMT_SYMBOLS_PER_BYTE;
+        if (count > data_size - byte) {
+            count = data_size - byte;
+        }
+        // plain word copies, symbols may point straight into the channel memory
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t *expanded = table->symbols[data[byte + i]];
+            for (int bit = 0; bit < LED_RMT_SYMBOLS_PER_BYTE; bit++) {
+                symbols[bit] = expanded[bit];
+            }
+            symbols += LED_RMT_SYMBOLS_PER_BYTE;
+        }
+        return count * LED_RMT_SYMBOLS_PER_BYTE;
+    }
+
+    if (symbols_free < 1) {
+        return 0;
+    }
+    symbols[0] = table->reset;
+    *done = true;
+    return 1;
+}
+
+#ifdef __cplusplus
+}
+#endif
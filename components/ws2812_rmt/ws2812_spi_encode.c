@@ -0,0 +1,95 @@
+#include "ws2812_spi_encode.h"
+
+bool led_spi_code_init(led_spi_code_t *code, int bits_per_bit, int zero_bits, int one_bits)
+{
+    if (bits_per_bit < 3 || bits_per_bit > LED_SPI_MAX_BITS_PER_BIT || zero_bits < 1 || one_bits <= zero_bits ||
+        one_bits >= bits_per_bit) {
+        return false;
+    }
+    code->bits_per_bit = bits_per_bit;
+    code->zero_bits = zero_bits;
+    code->one_bits = one_bits;
+    uint32_t mask = (1u << bits_per_bit) - 1;
+    uint32_t zero = mask & ~(mask >> zero_bits); // zero_bits high bits, then low
+    uint32_t one = mask & ~(mask >> one_bits);
+    for (int nibble = 0; nibble < 16; nibble++) {
+        uint32_t bits = 0;
+        for (int bit = 3; bit >= 0; bit--) {
+            bits = bits << bits_per_bit | ((nibble >> bit & 1) ? one : zero);
+        }
+        code->nibbles[nibble] = bits;
+    }
+    return true;
+}
+
+static uint32_t duration_error(uint32_t bits, uint32_t bit_ns, uint32_t want_ns)
+{
+    uint32_t ns = bits * bit_ns;
+    return ns > want_ns ? ns - want_ns : want_ns - ns;
+}
+
+bool led_spi_code_for_timing(const led_timing_t *timing, uint32_t tolerance_ns, led_spi_code_t *code,
+                             uint32_t *clock_hz)
+{
+    uint32_t period_ns = led_timing_period_ns(timing);
+    for (int bits_per_bit = 3; bits_per_bit <= LED_SPI_MAX_BITS_PER_BIT; bits_per_bit++) {
+        uint32_t bit_ns = (period_ns + bits_per_bit / 2) / bits_per_bit;
+        uint32_t best_error = UINT32_MAX;
+        int best_zero = 0;
+        int best_one = 0;
+        for (int zero_bits = 1; zero_bits < bits_per_bit; zero_bits++) {
+            for (int one_bits = zero_bits + 1; one_bits < bits_per_bit; one_bits++) {
+                uint32_t errors[4] = {
+                    duration_error(zero_bits, bit_ns, timing->t0h_ns),
+                    duration_error(bits_per_bit - zero_bits, bit_ns, timing->t0l_ns),
+                    duration_error(one_bits, bit_ns, timing->t1h_ns),
+                    duration_error(bits_per_bit - one_bits, bit_ns, timing->t1l_ns),
+                };
+                uint32_t error = 0;
+                for (int i = 0; i < 4; i++) {
+                    error = errors[i] > error ? errors[i] : error;
+                }
+                if (error < best_error) {
+                    best_error = error;
+                    best_zero = zero_bits;
+                    best_one = one_bits;
+                }
+            }
+        }
+        if (best_error <= tolerance_ns) {
+            *clock_hz = led_timing_bit_rate_hz(timing) * bits_per_bit;
+            return led_spi_code_init(code, bits_per_bit, best_zero, best_one);
+        }
+    }
+    return false;
+}
+
+size_t led_spi_encoded_size(size_t size, const led_spi_code_t *code)
+{
+    return size * code->bits_per_bit;
+}
+
+size_t led_spi_encode(const uint8_t *src, size_t size, uint8_t *dst, const led_spi_code_t *code)
+{
+    uint8_t *out = dst;
+    if (code->bits_per_bit == 3) {
+        for (size_t i = 0; i < size; i++) {
+            uint32_t bits = (uint32_t)code->nibbles[src[i] >> 4] << 12 | code->nibbles[src[i] & 0x0F];
+            out[0] = bits >> 16;
+            out[1] = bits >> 8;
+            out[2] = bits;
+            out += 3;
+        }
+    } else {
+        for (size_t i = 0; i < size; i++) {
+            uint16_t hi = code->nibbles[src[i] >> 4];
+            uint16_t lo = code->nibbles[src[i] & 0x0F];
+            out[0] = hi >> 8;
+            out[1] = hi;
+            out[2] = lo >> 8;
+            out[3] = lo;
+            out += 4;
+        }
+    }
+    return out - dst;
+}
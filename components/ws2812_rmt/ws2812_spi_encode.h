@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "ws2812_timing.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Most SPI bits per WS2812 data bit, four data bits fill 16 SPI bits
+ */
+#define LED_SPI_MAX_BITS_PER_BIT 4
+
+/**
+ * @brief How data bits are written as SPI bits
+ *
+ * Every data bit becomes bits_per_bit SPI bits, MSB first: a high pulse of
+ * zero_bits (0) or one_bits (1) SPI bits, then low. 100/110 is the usual
+ * 3-bit code, 1000/1100 suits chips with a long bit period.
+ */
+typedef struct {
+    uint8_t bits_per_bit;      /*!< SPI bits per data bit, 3 or 4 */
+    uint8_t zero_bits;         /*!< High SPI bits of a 0 */
+    uint8_t one_bits;          /*!< High SPI bits of a 1 */
+    uint16_t nibbles[16];      /*!< SPI bits of every nibble, in the low 4 * bits_per_bit bits */
+} led_spi_code_t;
+
+/**
+ * @brief Set up a code
+ *
+ * @param[out] code Code
+ * @param bits_per_bit SPI bits per data bit, 3 or 4
+ * @param zero_bits High SPI bits of a 0
+ * @param one_bits High SPI bits of a 1, more than zero_bits and less than bits_per_bit
+ * @return true on success, false for an unsupported code
+ */
+bool led_spi_code_init(led_spi_code_t *code, int bits_per_bit, int zero_bits, int one_bits);
+
+/**
+ * @brief Pick the code and SPI clock for a timing
+ *
+ * The SPI clock is bits_per_bit times the data bit rate, so the bit period
+ * is exact. Tries 3 and then 4 bits per bit, with every pulse width, and
+ * takes the first code whose four durations are all within tolerance_ns of
+ * the timing, the closest one of its size.
+ *
+ * @param timing Timing
+ * @param tolerance_ns Largest error of a high or low time
+ * @param[out] code Code
+ * @param[out] clock_hz SPI clock
+ * @return true on success, false if no code fits the timing
+ */
+bool led_spi_code_for_timing(const led_timing_t *timing, uint32_t tolerance_ns, led_spi_code_t *code,
+                             uint32_t *clock_hz);
+
+/**
+ * @brief Get the size of a WS2812 byte stream after SPI encoding
+ *
+ * @param size Number of data bytes
+ * @param code Code
+ * @return size_t Encoded size in bytes
+ */
+size_t led_spi_encoded_size(size_t size, const led_spi_code_t *code);
+
+/**
+ * @brief Encode a WS2812 byte stream as an SPI MOSI bit stream
+ *
+ * Has no dependencies besides libc, so it also builds on the host.
+ *
+ * @param src Data bytes in wire order
+ * @param size Number of data bytes
+ * @param[out] dst Encoded output, led_spi_encoded_size() bytes
+ * @param code Code
+ * @return size_t Number of bytes written
+ */
+size_t led_spi_encode(const uint8_t *src, size_t size, uint8_t *dst, const led_spi_code_t *code);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,84 @@
+#include <string.h>
+#if __has_include("sdkconfig.h")
+#include "sdkconfig.h"
+#endif
+#include "ws2812_timing.h"
+
+#ifdef CONFIG_WS2812_T0H
+#define LED_TIMING_CUSTOM_T0H CONFIG_WS2812_T0H
+#define LED_TIMING_CUSTOM_T0L CONFIG_WS2812_T0L
+#define LED_TIMING_CUSTOM_T1H CONFIG_WS2812_T1H
+#define LED_TIMING_CUSTOM_T1L CONFIG_WS2812_T1L
+#define LED_TIMING_CUSTOM_RESET CONFIG_WS2812_RESET_US
+#else
+// Kconfig defaults, for builds without sdkconfig.h
+#define LED_TIMING_CUSTOM_T0H 400
+#define LED_TIMING_CUSTOM_T0L 850
+#define LED_TIMING_CUSTOM_T1H 800
+#define LED_TIMING_CUSTOM_T1L 450
+#define LED_TIMING_CUSTOM_RESET 280
+#endif
+
+#define LED_TIMING_MAX_TICKS 0x7FFF // 15-bit RMT symbol duration
+
+// Datasheet values, as short as each chip reliably accepts
+static const led_timing_t timings[LED_TIMING_MAX] = {
+    [LED_TIMING_WS2812B] = { "ws2812b", 400, 850, 800, 450, 280 },
+    [LED_TIMING_WS2811] = { "ws2811", 500, 2000, 1200, 1300, 50 },
+    [LED_TIMING_SK6812] = { "sk6812", 300, 900, 600, 600, 80 },
+    [LED_TIMING_APA106] = { "apa106", 350, 1360, 1360, 350, 50 },
+    [LED_TIMING_WS2815] = { "ws2815", 300, 700, 700, 300, 280 },
+    [LED_TIMING_CUSTOM] = { "custom", LED_TIMING_CUSTOM_T0H, LED_TIMING_CUSTOM_T0L,
+                            LED_TIMING_CUSTOM_T1H, LED_TIMING_CUSTOM_T1L, LED_TIMING_CUSTOM_RESET },
+};
+
+const led_timing_t *led_timing_get(led_timing_profile_t profile)
+{
+    return profile < LED_TIMING_MAX ? &timings[profile] : NULL;
+}
+
+led_timing_profile_t led_timing_from_name(const char *name)
+{
+    for (int i = 0; i < LED_TIMING_MAX; i++) {
+        if (name && strcmp(name, timings[i].name) == 0) {
+            return i;
+        }
+    }
+    return LED_TIMING_MAX;
+}
+
+static bool led_timing_ns_to_ticks(uint32_t ns, uint32_t ticks_per_us, uint16_t *ticks)
+{
+    uint32_t value = (ns * ticks_per_us + 500) / 1000;
+    if (value == 0 || value > LED_TIMING_MAX_TICKS) {
+        return false;
+    }
+    *ticks = value;
+    return true;
+}
+
+bool led_timing_to_ticks(const led_timing_t *timing, uint32_t resolution_hz, led_timing_ticks_t *ticks)
+{
+    if (!timing || !ticks) {
+        return false;
+    }
+    uint32_t ticks_per_us = resolution_hz / 1000000;
+    return led_timing_ns_to_ticks(timing->t0h_ns, ticks_per_us, &ticks->t0h) &&
+           led_timing_ns_to_ticks(timing->t0l_ns, ticks_per_us, &ticks->t0l) &&
+           led_timing_ns_to_ticks(timing->t1h_ns, ticks_per_us, &ticks->t1h) &&
+           led_timing_ns_to_ticks(timing->t1l_ns, ticks_per_us, &ticks->t1l) &&
+           led_timing_ns_to_ticks(timing->reset_us * 1000 / 2, ticks_per_us, &ticks->reset_half);
+}
+
+uint32_t led_timing_period_ns(const led_timing_t *timing)
+{
+    // The built-in profiles give both bits the same period, a custom one may not
+    uint32_t zero_ns = timing->t0h_ns + timing->t0l_ns;
+    uint32_t one_ns = timing->t1h_ns + timing->t1l_ns;
+    return zero_ns > one_ns ? zero_ns : one_ns;
+}
+
+uint32_t led_timing_bit_rate_hz(const led_timing_t *timing)
+{
+    return 1000000000UL / led_timing_period_ns(timing);
+}
@@ -23,7 +23,35 @@
 static const char *TAG = "led_controller";
 static httpd_handle_t server = NULL;
 
-static uint8_t led_strip_pixels[NUM_LEDS * 3];
+static led_color_t *led_strip_pixels = NULL;
+static uint32_t num_leds = 0;
+
+// Read the whole request body into a NUL-terminated buffer. A body that does
+// not fit is refused with 413 rather than parsed truncated; on failure the
+// response has been sent and the handler returns the error.
+static esp_err_t recv_body(httpd_req_t *req, char *buf, size_t size)
+{
+    if (req->content_len >= size) {
+        httpd_resp_set_status(req, "413 Content Too Large");
+        httpd_resp_sendstr(req, "Request body too large");
+        return ESP_FAIL;
+    }
+
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+            continue;
+        }
+        if (ret <= 0) {
+            httpd_resp_send_408(req);
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    buf[received] = '\0';
+    return ESP_OK;
+}
 
 // Root page handler
 static esp_err_t root_handler(httpd_req_t *req)
@@ -84,12 +112,16 @@ static void set_led_color(int index, uint8_t r, uint8_t g, uint8_t b, uint8_t br
 {
     ESP_LOGI(TAG, "Received request to set LED %d to brightness: %d, color: (%d, %d, %d)", index, brightness, r, g, b);
 
-    if (index < 0 || index >= NUM_LEDS) return;
+    if (index < 0 || index >= (int)num_leds) return;
 
-    // Apply brightness
-    led_strip_pixels[index * 3 + 0] = (uint8_t)(((float)g * (float)brightness) / 100.f);
-    led_strip_pixels[index * 3 + 1] = (uint8_t)(((float)r * (float)brightness) / 100.f);
-    led_strip_pixels[index * 3 + 2] = (uint8_t)(((float)b * (float)brightness) / 100.f);
+    // Brightness is a percentage of this LED only, scaled into its color so
+    // the strip brightness stays as it is
+    if (brightness > 100) brightness = 100;
+    led_strip_pixels[index] = (led_color_t){
+        .r = (r * brightness + 50) / 100,
+        .g = (g * brightness + 50) / 100,
+        .b = (b * brightness + 50) / 100,
+    };
 
     ESP_LOGI(TAG, "Setting LED %d to %d, %d, %d", index, r, g, b);
     // Update all LEDs
@@ -99,20 +131,29 @@ static void set_led_color(int index, uint8_t r, uint8_t g, uint8_t b, uint8_t br
 // HTTP GET handler
 static esp_err_t led_get_handler(httpd_req_t *req)
 {
+    // Stream the array in chunks, a long strip does not fit in one stack buffer
     char resp[512];
     char *ptr = resp;
+    httpd_resp_set_type(req, "application/json");
     ptr += sprintf(ptr, "[");
-    for (int i = 0; i < NUM_LEDS; i++) {
+    for (uint32_t i = 0; i < num_leds; i++) {
         if (i > 0) ptr += sprintf(ptr, ",");
+        // The colors have their brightness scaled in already
         ptr += sprintf(ptr, "{\"g\":%u,\"r\":%u,\"b\":%u,\"brightness\":100}", 
-                      led_strip_pixels[i * 3 + 0], 
-                      led_strip_pixels[i * 3 + 1], 
-                      led_strip_pixels[i * 3 + 2]);
+                      led_strip_pixels[i].g, 
+                      led_strip_pixels[i].r, 
+                      led_strip_pixels[i].b);
+        if ((size_t)(ptr - resp) > sizeof(resp) - 64) {
+            if (httpd_resp_send_chunk(req, resp, ptr - resp) != ESP_OK) {
+                return ESP_FAIL;
+            }
+            ptr = resp;
+        }
     }
     ptr += sprintf(ptr, "]");
     
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_send(req, resp, strlen(resp));
+    httpd_resp_send_chunk(req, resp, ptr - resp);
+    httpd_resp_send_chunk(req, NULL, 0);
     return ESP_OK;
 }
 
@@ -120,16 +161,9 @@ static esp_err_t led_get_handler(httpd_req_t *req)
 static esp_err_t led_post_handler(httpd_req_t *req)
 {
     char content[100];
-    size_t recv_size = req->content_len;
-    if (recv_size > sizeof(content) - 1) {
-        recv_size = sizeof(content) - 1;
-    }
-
-    int ret = httpd_req_recv(req, content, recv_size);
-    if (ret <= 0) {
+    if (recv_body(req, content, sizeof(content)) != ESP_OK) {
         return ESP_FAIL;
     }
-    content[recv_size] = '\0';
 
     // Parse JSON using cJSON
     cJSON *root = cJSON_Parse(content);
@@ -161,7 +195,7 @@ static esp_err_t led_post_handler(httpd_req_t *req)
     // Clean up
     cJSON_Delete(root);
 
-    if (index >= 0 && index < NUM_LEDS) {
+    if (index >= 0 && index < (int)num_leds) {
         set_led_color(index, r, g, b, brightness);
     }
 
@@ -185,20 +219,89 @@ static httpd_uri_t led_post = {
     .user_ctx  = NULL
 };
 
-// Animation API handler
-static esp_err_t animation_api_handler(httpd_req_t *req)
+// Read the animation fields of a JSON object, missing fields get the web defaults.
+// Returns false when a field cannot be represented in the configuration.
+static bool parse_animation(cJSON *json, animation_config_t *config)
 {
-    char content[100];
-    size_t recv_size = req->content_len;
-    if (recv_size > sizeof(content) - 1) {
-        recv_size = sizeof(content) - 1;
+    memset(config, 0, sizeof(*config));
+    // The type is a number or an effect name from /api/effects
+    cJSON *type_json = cJSON_GetObjectItem(json, "type");
+    if (cJSON_IsString(type_json)) config->type = animation_type_from_name(type_json->valuestring);
+    else if (type_json) config->type = (animation_type_t)type_json->valueint;
+
+    cJSON *speed_json = cJSON_GetObjectItem(json, "speed");
+    if (speed_json) config->speed = speed_json->valueint;
+    else config->speed = 50;
+
+    cJSON *brightness_json = cJSON_GetObjectItem(json, "brightness");
+    if (brightness_json) config->brightness = brightness_json->valueint;
+    else config->brightness = 255;
+
+    // Blend from the running animation, a crossfade unless the request says otherwise
+    config->transition = ANIMATION_TRANSITION_FADE;
+    config->transition_ms = ANIMATION_TRANSITION_MS;
+    cJSON *transition_json = cJSON_GetObjectItem(json, "transition");
+    if (cJSON_IsString(transition_json)) {
+        config->transition = animation_transition_from_name(transition_json->valuestring);
+    }
+    cJSON *transition_ms_json = cJSON_GetObjectItem(json, "transition_ms");
+    if (transition_ms_json) config->transition_ms = transition_ms_json->valueint;
+
+    // Converting a double outside 0..UINT32_MAX to the seed is undefined
+    cJSON *seed_json = cJSON_GetObjectItem(json, "seed");
+    if (seed_json) {
+        if (!cJSON_IsNumber(seed_json) || !(seed_json->valuedouble >= 0 && seed_json->valuedouble <= UINT32_MAX)) {
+            return false;
+        }
+        config->seed = seed_json->valuedouble;
+    }
+
+    // A palette name from /api/palettes, unknown names leave the animation's own
+    cJSON *palette_json = cJSON_GetObjectItem(json, "palette");
+    if (cJSON_IsString(palette_json)) config->palette = led_palette_find(palette_json->valuestring);
+
+    cJSON *color_json = cJSON_GetObjectItem(json, "color");
+    if (color_json) {
+        cJSON *r_json = cJSON_GetObjectItem(color_json, "r");
+        cJSON *g_json = cJSON_GetObjectItem(color_json, "g");
+        cJSON *b_json = cJSON_GetObjectItem(color_json, "b");
+        if (r_json) config->r = r_json->valueint;
+        if (g_json) config->g = g_json->valueint;
+        if (b_json) config->b = b_json->valueint;
+    } else {
+        config->r = 255;
+        config->g = 255;
+        config->b = 255;
     }
+    return true;
+}
 
-    int ret = httpd_req_recv(req, content, recv_size);
-    if (ret <= 0) {
+// Write the animation fields of a configuration into a JSON object
+static void add_animation(cJSON *json, const animation_config_t *config)
+{
+    cJSON_AddNumberToObject(json, "type", config->type);
+    cJSON_AddNumberToObject(json, "speed", config->speed);
+    cJSON *color = cJSON_AddObjectToObject(json, "color");
+    cJSON_AddNumberToObject(color, "r", config->r);
+    cJSON_AddNumberToObject(color, "g", config->g);
+    cJSON_AddNumberToObject(color, "b", config->b);
+    const char *transition = animation_transition_name(config->transition);
+    cJSON_AddStringToObject(json, "transition", transition ? transition : "none");
+    cJSON_AddNumberToObject(json, "transition_ms", config->transition_ms);
+    cJSON_AddNumberToObject(json, "seed", config->seed);
+    led_palette_t palette;
+    if (led_palette_get(config->palette, &palette) == ESP_OK) {
+        cJSON_AddStringToObject(json, "palette", palette.name);
+    }
+}
+
+// Animation API handler
+static esp_err_t animation_api_handler(httpd_req_t *req)
+{
+    char content[256];
+    if (recv_body(req, content, sizeof(content)) != ESP_OK) {
         return ESP_FAIL;
     }
-    content[recv_size] = '\0';
 
     // Parse JSON
     cJSON *root = cJSON_Parse(content);
@@ -215,36 +318,38 @@ static esp_err_t animation_api_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    animation_config_t config = {0};
-    config.type = (animation_type_t)type_json->valueint;
-    
-    // Get optional parameters
-    cJSON *speed_json = cJSON_GetObjectItem(root, "speed");
-    if (speed_json) config.speed = speed_json->valueint;
-    else config.speed = 50;
-
-    cJSON *brightness_json = cJSON_GetObjectItem(root, "brightness");
-    if (brightness_json) config.brightness = brightness_json->valueint;
-    else config.brightness = 100;
+    // Get the animation and its optional parameters
+    animation_config_t config;
+    if (!parse_animation(root, &config)) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid animation");
+        return ESP_FAIL;
+    }
 
-    cJSON *color_json = cJSON_GetObjectItem(root, "color");
-    if (color_json) {
-        cJSON *r_json = cJSON_GetObjectItem(color_json, "r");
-        cJSON *g_json = cJSON_GetObjectItem(color_json, "g");
-        cJSON *b_json = cJSON_GetObjectItem(color_json, "b");
-        if (r_json) config.r = r_json->valueint;
-        if (g_json) config.g = g_json->valueint;
-        if (b_json) config.b = b_json->valueint;
-    } else {
-        config.r = 255;
-        config.g = 255;
-        config.b = 255;
+    // A layer index puts the animation on that compositor layer instead of
+    // replacing the base animation and the strip brightness
+    cJSON *layer_json = cJSON_GetObjectItem(root, "layer");
+    animation_layer_config_t layer_config = {
+        .animation = config,
+        .opacity = 255,
+        .blend = LED_BLEND_NORMAL,
+    };
+    cJSON *opacity_json = cJSON_GetObjectItem(root, "opacity");
+    if (opacity_json) layer_config.opacity = opacity_json->valueint;
+    cJSON *blend_json = cJSON_GetObjectItem(root, "blend");
+    if (cJSON_IsString(blend_json)) {
+        layer_config.blend = led_blend_mode_from_name(blend_json->valuestring);
     }
+    int layer = layer_json ? layer_json->valueint : -1;
 
     cJSON_Delete(root);
 
     // Start animation
-    esp_err_t err = animation_start(&config);
+    esp_err_t err = layer < 0 ? animation_start(&config) : animation_set_layer(layer, &layer_config);
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid animation");
+        return ESP_FAIL;
+    }
     if (err != ESP_OK) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to start animation");
         return ESP_FAIL;
@@ -262,6 +367,378 @@ static httpd_uri_t animation_api = {
     .user_ctx  = NULL
 };
 
+// Effects GET handler, every animation the firmware has, for the web UI
+static esp_err_t effects_get_handler(httpd_req_t *req)
+{
+    cJSON *root = cJSON_CreateArray();
+    for (int type = 0; type < ANIMATION_MAX; type++) {
+        const animation_effect_info_t *info = animation_get_effect_info(type);
+        cJSON *effect = cJSON_CreateObject();
+        cJSON_AddNumberToObject(effect, "type", type);
+        cJSON_AddStringToObject(effect, "name", info->name);
+        cJSON_AddStringToObject(effect, "label", info->label);
+        cJSON *params = cJSON_AddArrayToObject(effect, "params");
+        if (info->params & ANIMATION_PARAM_SPEED) {
+            cJSON_AddItemToArray(params, cJSON_CreateString("speed"));
+        }
+        if (info->params & ANIMATION_PARAM_COLOR) {
+            cJSON_AddItemToArray(params, cJSON_CreateString("color"));
+        }
+        if (info->params & ANIMATION_PARAM_PALETTE) {
+            cJSON_AddItemToArray(params, cJSON_CreateString("palette"));
+        }
+        cJSON_AddItemToArray(root, effect);
+    }
+    char *resp = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!resp) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    free(resp);
+    return ESP_OK;
+}
+
+static httpd_uri_t effects_get = {
+    .uri       = "/api/effects",
+    .method    = HTTP_GET,
+    .handler   = effects_get_handler,
+    .user_ctx  = NULL
+};
+
+// Palettes GET handler, the built-in palettes and the uploaded ones
+static esp_err_t palettes_get_handler(httpd_req_t *req)
+{
+    cJSON *root = cJSON_CreateArray();
+    for (int id = LED_PALETTE_NONE + 1; id < LED_PALETTE_MAX; id++) {
+        led_palette_t palette;
+        if (led_palette_get(id, &palette) != ESP_OK) {
+            continue;
+        }
+        cJSON *palette_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(palette_json, "name", palette.name);
+        cJSON_AddBoolToObject(palette_json, "builtin", id < LED_PALETTE_USER);
+        cJSON *stops = cJSON_AddArrayToObject(palette_json, "stops");
+        for (int i = 0; i < palette.num_stops; i++) {
+            const led_palette_stop_t *stop = &palette.stops[i];
+            int values[4] = { stop->pos, stop->r, stop->g, stop->b };
+            cJSON_AddItemToArray(stops, cJSON_CreateIntArray(values, 4));
+        }
+        cJSON_AddItemToArray(root, palette_json);
+    }
+    char *resp = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!resp) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    free(resp);
+    return ESP_OK;
+}
+
+// Palettes POST handler, uploads a palette or replaces the uploaded one of the same name
+static esp_err_t palettes_post_handler(httpd_req_t *req)
+{
+    char content[1024];
+    if (recv_body(req, content, sizeof(content)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    // {"name": "sunset", "stops": [[pos, r, g, b], ...]}
+    led_palette_t palette = { 0 };
+    cJSON *name_json = cJSON_GetObjectItem(root, "name");
+    cJSON *stops_json = cJSON_GetObjectItem(root, "stops");
+    int count = cJSON_GetArraySize(stops_json);
+    bool valid = cJSON_IsString(name_json) && strlen(name_json->valuestring) < LED_PALETTE_NAME_LEN &&
+                 cJSON_IsArray(stops_json) && count <= LED_PALETTE_MAX_STOPS;
+    if (valid) {
+        strcpy(palette.name, name_json->valuestring);
+        palette.num_stops = count;
+        for (int i = 0; i < count && valid; i++) {
+            cJSON *stop_json = cJSON_GetArrayItem(stops_json, i);
+            int values[4];
+            valid = cJSON_GetArraySize(stop_json) == 4;
+            for (int j = 0; j < 4 && valid; j++) {
+                cJSON *value_json = cJSON_GetArrayItem(stop_json, j);
+                values[j] = cJSON_IsNumber(value_json) ? value_json->valueint : -1;
+                valid = values[j] >= 0 && values[j] <= 255;
+            }
+            if (valid) {
+                palette.stops[i] = (led_palette_stop_t){ values[0], values[1], values[2], values[3] };
+            }
+        }
+    }
+    cJSON_Delete(root);
+
+    esp_err_t err = valid ? led_palette_set(&palette, NULL) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid palette");
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "No free palette slot");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Palette %s uploaded with %d stops", palette.name, count);
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+    return ESP_OK;
+}
+
+static httpd_uri_t palettes_get = {
+    .uri       = "/api/palettes",
+    .method    = HTTP_GET,
+    .handler   = palettes_get_handler,
+    .user_ctx  = NULL
+};
+
+static httpd_uri_t palettes_post = {
+    .uri       = "/api/palettes",
+    .method    = HTTP_POST,
+    .handler   = palettes_post_handler,
+    .user_ctx  = NULL
+};
+
+// Segments GET handler, the segment table of every layer
+static esp_err_t segments_get_handler(httpd_req_t *req)
+{
+    cJSON *root = cJSON_CreateObject();
+    cJSON *layers = cJSON_AddArrayToObject(root, "layers");
+    for (uint32_t i = 0; i < ANIMATION_MAX_LAYERS; i++) {
+        animation_layer_config_t layer_config;
+        animation_segment_config_t segments[ANIMATION_MAX_SEGMENTS];
+        uint32_t count;
+        animation_get_layer(i, &layer_config);
+        animation_get_segments(i, segments, &count);
+
+        cJSON *layer = cJSON_CreateObject();
+        cJSON_AddNumberToObject(layer, "opacity", layer_config.opacity);
+        cJSON_AddStringToObject(layer, "blend", led_blend_mode_name(layer_config.blend));
+        cJSON *segments_json = cJSON_AddArrayToObject(layer, "segments");
+        for (uint32_t j = 0; j < count; j++) {
+            cJSON *segment = cJSON_CreateObject();
+            cJSON_AddNumberToObject(segment, "start", segments[j].start);
+            cJSON_AddNumberToObject(segment, "length", segments[j].length);
+            cJSON_AddBoolToObject(segment, "reverse", segments[j].reverse);
+            cJSON_AddBoolToObject(segment, "mirror", segments[j].mirror);
+            cJSON_AddNumberToObject(segment, "brightness", segments[j].brightness);
+            add_animation(segment, &segments[j].animation);
+            cJSON_AddItemToArray(segments_json, segment);
+        }
+        cJSON_AddItemToArray(layers, layer);
+    }
+    char *resp = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!resp) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    free(resp);
+    return ESP_OK;
+}
+
+// Segments POST handler, replaces the segment table of one layer
+static esp_err_t segments_post_handler(httpd_req_t *req)
+{
+    char content[1024];
+    if (recv_body(req, content, sizeof(content)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    cJSON *segments_json = cJSON_GetObjectItem(root, "segments");
+    int count = cJSON_GetArraySize(segments_json);
+    if (!cJSON_IsArray(segments_json) || count > ANIMATION_MAX_SEGMENTS) {
+        cJSON_Delete(root);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid segment list");
+        return ESP_FAIL;
+    }
+
+    animation_segment_config_t segments[ANIMATION_MAX_SEGMENTS];
+    for (int i = 0; i < count; i++) {
+        cJSON *segment_json = cJSON_GetArrayItem(segments_json, i);
+        cJSON *start_json = cJSON_GetObjectItem(segment_json, "start");
+        cJSON *length_json = cJSON_GetObjectItem(segment_json, "length");
+        cJSON *brightness_json = cJSON_GetObjectItem(segment_json, "brightness");
+        segments[i].start = start_json ? start_json->valueint : 0;
+        segments[i].length = length_json ? length_json->valueint : 0;
+        segments[i].reverse = cJSON_IsTrue(cJSON_GetObjectItem(segment_json, "reverse"));
+        segments[i].mirror = cJSON_IsTrue(cJSON_GetObjectItem(segment_json, "mirror"));
+        segments[i].brightness = brightness_json ? brightness_json->valueint : 255;
+        if (!parse_animation(segment_json, &segments[i].animation)) {
+            cJSON_Delete(root);
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid segments");
+            return ESP_FAIL;
+        }
+    }
+    cJSON *layer_json = cJSON_GetObjectItem(root, "layer");
+    int layer = layer_json ? layer_json->valueint : 0;
+    cJSON_Delete(root);
+
+    esp_err_t err = animation_set_segments(layer, segments, count);
+    if (err == ESP_ERR_INVALID_ARG) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid segments");
+        return ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to set segments");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+    return ESP_OK;
+}
+
+static httpd_uri_t segments_get = {
+    .uri       = "/api/segments",
+    .method    = HTTP_GET,
+    .handler   = segments_get_handler,
+    .user_ctx  = NULL
+};
+
+static httpd_uri_t segments_post = {
+    .uri       = "/api/segments",
+    .method    = HTTP_POST,
+    .handler   = segments_post_handler,
+    .user_ctx  = NULL
+};
+
+// Strip configuration GET handler
+static esp_err_t strip_get_handler(httpd_req_t *req)
+{
+    led_strip_config_t config;
+    if (led_strip_load_config(&config) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to load strip configuration");
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *outputs = cJSON_AddArrayToObject(root, "outputs");
+    for (uint32_t i = 0; i < config.num_outputs; i++) {
+        cJSON *output = cJSON_CreateObject();
+        cJSON_AddStringToObject(output, "backend", config.outputs[i].backend == LED_STRIP_BACKEND_SPI ? "spi" : "rmt");
+        cJSON_AddStringToObject(output, "format", led_pixel_format_name(config.outputs[i].pixel_format));
+        const led_timing_t *timing = led_timing_get(config.outputs[i].timing);
+        cJSON_AddStringToObject(output, "timing", timing ? timing->name : "unknown");
+        cJSON_AddNumberToObject(output, "gpio", config.outputs[i].gpio_num);
+        cJSON_AddNumberToObject(output, "num_leds", config.outputs[i].num_leds);
+        cJSON_AddItemToArray(outputs, output);
+    }
+    cJSON_AddNumberToObject(root, "active_num_leds", num_leds);
+    led_strip_stats_t stats;
+    led_strip_get_stats(&stats);
+    cJSON_AddNumberToObject(root, "frames_sent", stats.frames_sent);
+    cJSON_AddNumberToObject(root, "frames_skipped", stats.frames_skipped);
+    animation_stats_t animation_stats;
+    animation_get_stats(&animation_stats);
+    cJSON_AddNumberToObject(root, "frames_dropped", animation_stats.frames_dropped);
+    cJSON_AddNumberToObject(root, "frames_cached", animation_stats.frames_cached);
+    char *resp = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!resp) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    free(resp);
+    return ESP_OK;
+}
+
+// Strip configuration POST handler, the new layout is used after a restart
+static esp_err_t strip_post_handler(httpd_req_t *req)
+{
+    char content[512];
+    if (recv_body(req, content, sizeof(content)) != ESP_OK) {
+        return ESP_FAIL;
+    }
+
+    cJSON *root = cJSON_Parse(content);
+    if (!root) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+
+    led_strip_config_t config;
+    led_strip_load_config(&config);
+
+    // Either a full output list or just the length of a single-output strip
+    cJSON *outputs_json = cJSON_GetObjectItem(root, "outputs");
+    cJSON *num_leds_json = cJSON_GetObjectItem(root, "num_leds");
+    if (cJSON_IsArray(outputs_json)) {
+        int count = cJSON_GetArraySize(outputs_json);
+        config.num_outputs = count;
+        for (int i = 0; i < count && i < RMT_LED_STRIP_MAX_OUTPUTS; i++) {
+            cJSON *output_json = cJSON_GetArrayItem(outputs_json, i);
+            cJSON *gpio_json = cJSON_GetObjectItem(output_json, "gpio");
+            cJSON *leds_json = cJSON_GetObjectItem(output_json, "num_leds");
+            cJSON *backend_json = cJSON_GetObjectItem(output_json, "backend");
+            cJSON *format_json = cJSON_GetObjectItem(output_json, "format");
+            cJSON *timing_json = cJSON_GetObjectItem(output_json, "timing");
+            if (gpio_json) config.outputs[i].gpio_num = gpio_json->valueint;
+            if (cJSON_IsString(backend_json)) {
+                config.outputs[i].backend = strcmp(backend_json->valuestring, "spi") == 0 ?
+                                            LED_STRIP_BACKEND_SPI : LED_STRIP_BACKEND_RMT;
+            }
+            if (cJSON_IsString(format_json)) {
+                config.outputs[i].pixel_format = led_pixel_format_from_name(format_json->valuestring);
+            }
+            if (cJSON_IsString(timing_json)) {
+                config.outputs[i].timing = led_timing_from_name(timing_json->valuestring);
+            }
+            config.outputs[i].num_leds = leds_json ? leds_json->valueint : 0;
+        }
+    } else if (num_leds_json) {
+        config.num_outputs = 1;
+        config.outputs[0].num_leds = num_leds_json->valueint;
+    }
+    cJSON_Delete(root);
+
+    if (led_strip_store_config(&config) != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid strip configuration");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Stored strip layout with %lu outputs, restart to apply", (unsigned long)config.num_outputs);
+    httpd_resp_sendstr(req, "{\"status\":\"ok\",\"restart_required\":true}");
+    return ESP_OK;
+}
+
+static httpd_uri_t strip_get = {
+    .uri       = "/api/strip",
+    .method    = HTTP_GET,
+    .handler   = strip_get_handler,
+    .user_ctx  = NULL
+};
+
+static httpd_uri_t strip_post = {
+    .uri       = "/api/strip",
+    .method    = HTTP_POST,
+    .handler   = strip_post_handler,
+    .user_ctx  = NULL
+};
+
 // Initialize mDNS service with error handling
 static bool init_mdns(void)
 {
@@ -401,12 +878,20 @@ static httpd_handle_t start_webserver(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.stack_size = 8192;
+    config.max_uri_handlers = 12;
     
     if (httpd_start(&server, &config) == ESP_OK) {
         httpd_register_uri_handler(server, &root);
         httpd_register_uri_handler(server, &led_get);
         httpd_register_uri_handler(server, &led_post);
         httpd_register_uri_handler(server, &animation_api);
+        httpd_register_uri_handler(server, &strip_get);
+        httpd_register_uri_handler(server, &strip_post);
+        httpd_register_uri_handler(server, &segments_get);
+        httpd_register_uri_handler(server, &segments_post);
+        httpd_register_uri_handler(server, &effects_get);
+        httpd_register_uri_handler(server, &palettes_get);
+        httpd_register_uri_handler(server, &palettes_post);
         return server;
     }
     return NULL;
@@ -425,8 +910,23 @@ void app_main(void)
     // Initialize SPIFFS
     ESP_ERROR_CHECK(init_spiffs());
 
-    // Initialize LED strip with default configuration
-    ESP_ERROR_CHECK(led_strip_init(NULL));
+    // Initialize LED strip with the configuration stored in NVS
+    led_strip_config_t strip_config;
+    ESP_ERROR_CHECK(led_strip_load_config(&strip_config));
+    ret = led_strip_init(&strip_config);
+    if (ret != ESP_OK) {
+        // A stored layout the hardware rejects must not stop every boot,
+        // start with the defaults so /api/strip can fix it
+        ESP_LOGE(TAG, "Strip layout from NVS failed (%s), using the defaults", esp_err_to_name(ret));
+        ESP_ERROR_CHECK(led_strip_init(NULL));
+    }
+
+    num_leds = led_strip_get_num_leds();
+    led_strip_pixels = calloc(num_leds, sizeof(led_color_t));
+    if (!led_strip_pixels) {
+        ESP_LOGE(TAG, "Failed to allocate pixel buffer for %lu LEDs", (unsigned long)num_leds);
+        ESP_ERROR_CHECK(ESP_ERR_NO_MEM);
+    }
 
     // Initialize animations
     ESP_ERROR_CHECK(animation_init());
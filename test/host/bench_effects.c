@@ -0,0 +1,109 @@
+// Render cost of ocean, aurora and breathing against the float kernels they
+// replaced, in ns per pixel on the host
+#include <math.h>
+#include <string.h>
+#include "host_test.h"
+#include "ws2812_effect.h"
+
+#define STRIP_LEDS      300
+#define FRAMES          20000
+
+static led_color_t pixels[STRIP_LEDS];
+static uint16_t scratch[STRIP_LEDS];
+static uint8_t led_state[STRIP_LEDS * ANIMATION_EFFECT_LED_STATE_SIZE];
+static volatile uint32_t sink;
+
+static float smooth_sin(float x)
+{
+    return (sin(x) + 1.0f) / 2.0f;
+}
+
+static void float_ocean(float time)
+{
+    for (uint32_t i = 0; i < STRIP_LEDS; i++) {
+        float wave1 = smooth_sin(time + i * 0.2f) * 0.5f;
+        float wave2 = smooth_sin(time * 0.7f + i * 0.1f) * 0.3f;
+        float wave3 = smooth_sin(time * 0.3f + i * 0.05f) * 0.2f;
+        float intensity = (wave1 + wave2 + wave3) * 0.7f;
+        pixels[i] = (led_color_t){ .r = 0, .g = 50 + (intensity * 50), .b = 100 + (intensity * 100) };
+    }
+}
+
+static void float_aurora(float time)
+{
+    for (uint32_t i = 0; i < STRIP_LEDS; i++) {
+        float pos = (float)i / STRIP_LEDS;
+        float wave1 = smooth_sin(time + pos * 3.0f) * 0.5f;
+        float wave2 = smooth_sin(time * 0.7f + pos * 2.0f) * 0.3f;
+        float wave3 = smooth_sin(time * 0.3f + pos * 1.0f) * 0.2f;
+        float intensity = (wave1 + wave2 + wave3) * 0.8f;
+        float green = (0.7f + (wave1 * 0.3f)) * intensity;
+        float blue = (0.5f + (wave2 * 0.5f)) * intensity;
+        float red = (0.3f + (wave3 * 0.7f)) * intensity;
+        pixels[i] = (led_color_t){ .r = red * 255, .g = green * 255, .b = blue * 255 };
+    }
+}
+
+static void float_breathing(float brightness)
+{
+    for (uint32_t i = 0; i < STRIP_LEDS; i++) {
+        pixels[i] = (led_color_t){ .r = 255 * brightness, .g = 128 * brightness, .b = 64 * brightness };
+    }
+}
+
+static double float_ns(animation_type_t type)
+{
+    double start = test_now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        switch (type) {
+        case ANIMATION_OCEAN:
+            float_ocean(f * 0.05f);
+            break;
+        case ANIMATION_AURORA:
+            float_aurora(f * 0.03f);
+            break;
+        default:
+            float_breathing((f % 100) * 0.01f);
+            break;
+        }
+        sink += pixels[f % STRIP_LEDS].g;
+    }
+    return (test_now_ns() - start) / FRAMES / STRIP_LEDS;
+}
+
+static double effect_ns(animation_type_t type)
+{
+    const animation_effect_def_t *def = &animation_effects[type];
+    animation_config_t config = { .type = type, .speed = 50, .brightness = 255, .r = 255, .g = 128, .b = 64 };
+    uint8_t state[ANIMATION_EFFECT_STATE_SIZE] = { 0 };
+    animation_span_t span = {
+        .pixels = pixels,
+        .num_leds = STRIP_LEDS,
+        .scratch = scratch,
+        .led_state = led_state,
+        .palette = led_palette_lut(def->palette),
+    };
+    if (def->init) {
+        def->init(state, &config);
+    }
+
+    double start = test_now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        animation_clock_t clock = { .time_us = f * 16667LL, .phase = (uint64_t)f << 16, .steps = 1 };
+        def->render(state, &config, &span, &clock);
+        sink += pixels[f % STRIP_LEDS].g;
+    }
+    return (test_now_ns() - start) / FRAMES / STRIP_LEDS;
+}
+
+int main(void)
+{
+    static const animation_type_t types[] = { ANIMATION_OCEAN, ANIMATION_AURORA, ANIMATION_BREATHING };
+    led_palette_update();
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        const char *name = animation_effects[types[i]].info.name;
+        printf("%-10s float %6.2f ns/pixel, fixed point %6.2f ns/pixel\n", name, float_ns(types[i]),
+               effect_ns(types[i]));
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Cost of value noise in ns per pixel on the host: one point at a time
+// against the fills, for every octave count, and the noise effects
+#include "host_test.h"
+#include "ws2812_effect.h"
+#include "ws2812_noise.h"
+
+#define STRIP_LEDS      300
+#define FRAMES          5000
+#define DX              (65536 / 12) // Q16, 12 LEDs per cell as in ocean_noise
+
+static uint16_t noise[STRIP_LEDS];
+static led_color_t pixels[STRIP_LEDS];
+static uint16_t scratch[STRIP_LEDS];
+static uint8_t led_state[STRIP_LEDS * ANIMATION_EFFECT_LED_STATE_SIZE];
+static volatile uint32_t sink;
+
+static double points_ns(uint32_t octaves)
+{
+    double start = test_now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        for (uint32_t i = 0; i < STRIP_LEDS; i++) {
+            noise[i] = led_noise16_octaves(f * 512 + i * DX, f * 256, 0, octaves);
+        }
+        sink += noise[f % STRIP_LEDS];
+    }
+    return (test_now_ns() - start) / FRAMES / STRIP_LEDS;
+}
+
+static double fill_ns(uint32_t octaves)
+{
+    double start = test_now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        led_noise16_fill(noise, STRIP_LEDS, f * 512, DX, f * 256, 0, octaves);
+        sink += noise[f % STRIP_LEDS];
+    }
+    return (test_now_ns() - start) / FRAMES / STRIP_LEDS;
+}
+
+static double effect_ns(animation_type_t type)
+{
+    const animation_effect_def_t *def = &animation_effects[type];
+    animation_config_t config = { .type = type, .speed = 50, .brightness = 255 };
+    uint8_t state[ANIMATION_EFFECT_STATE_SIZE] = { 0 };
+    animation_span_t span = {
+        .pixels = pixels,
+        .num_leds = STRIP_LEDS,
+        .scratch = scratch,
+        .led_state = led_state,
+        .palette = led_palette_lut(def->palette),
+    };
+
+    double start = test_now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        animation_clock_t clock = { .time_us = f * 16667LL, .phase = (uint64_t)f << 16, .steps = 1 };
+        def->render(state, &config, &span, &clock);
+        sink += pixels[f % STRIP_LEDS].r;
+    }
+    return (test_now_ns() - start) / FRAMES / STRIP_LEDS;
+}
+
+int main(void)
+{
+    for (uint32_t octaves = 1; octaves <= LED_NOISE_MAX_OCTAVES; octaves++) {
+        printf("%u octaves    points %6.2f ns/pixel, fill %6.2f ns/pixel\n", (unsigned)octaves, points_ns(octaves),
+               fill_ns(octaves));
+    }
+
+    static const animation_type_t types[] = { ANIMATION_OCEAN_NOISE, ANIMATION_AURORA_NOISE, ANIMATION_LAVA };
+    led_palette_update();
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        printf("%-13s %6.2f ns/pixel\n", animation_effects[types[i]].info.name, effect_ns(types[i]));
+    }
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Refill cost of the table encoder against expanding every bit with a branch,
+// what the generic bytes encoder does, in ns per data byte on the host
+#include <stdlib.h>
+#include "host_test.h"
+#include "ws2812_rmt_encode.h"
+
+#define STRIP_BYTES     (300 * 3)
+#define MEM_SYMBOLS     64
+#define FRAMES          20000
+
+static led_rmt_table_t table;
+static uint8_t frame[STRIP_BYTES];
+static uint32_t channel[MEM_SYMBOLS];
+static volatile uint32_t sink;
+
+static size_t bitwise_encode(const led_timing_ticks_t *ticks, const uint8_t *data, size_t data_size,
+                             size_t symbols_written, size_t symbols_free, uint32_t *symbols, bool *done)
+{
+    uint32_t bit0 = led_rmt_symbol(1, ticks->t0h, 0, ticks->t0l);
+    uint32_t bit1 = led_rmt_symbol(1, ticks->t1h, 0, ticks->t1l);
+    size_t byte = symbols_written / 8;
+    if (byte >= data_size) {
+        symbols[0] = led_rmt_symbol(0, ticks->reset_half, 0, ticks->reset_half);
+        *done = true;
+        return 1;
+    }
+    size_t count = symbols_free / 8;
+    if (count > data_size - byte) {
+        count = data_size - byte;
+    }
+    for (size_t i = 0; i < count; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            *symbols++ = (data[byte + i] >> bit & 1) ? bit1 : bit0;
+        }
+    }
+    return count * 8;
+}
+
+int main(void)
+{
+    led_timing_ticks_t ticks;
+    led_timing_to_ticks(led_timing_get(LED_TIMING_WS2812B), 10000000, &ticks);
+    led_rmt_table_build(&table, &ticks);
+    for (int i = 0; i < STRIP_BYTES; i++) {
+        frame[i] = rand();
+    }
+
+    double start = test_now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        size_t written = 0;
+        bool done = false;
+        while (!done) {
+            written += led_rmt_table_encode(&table, frame, STRIP_BYTES, written, MEM_SYMBOLS, channel, &done);
+            sink += channel[0];
+        }
+    }
+    double table_ns = (test_now_ns() - start) / FRAMES / STRIP_BYTES;
+
+    start = test_now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        size_t written = 0;
+        bool done = false;
+        while (!done) {
+            written += bitwise_encode(&ticks, frame, STRIP_BYTES, written, MEM_SYMBOLS, channel, &done);
+            sink += channel[0];
+        }
+    }
+    double bitwise_ns = (test_now_ns() - start) / FRAMES / STRIP_BYTES;
+
+    printf("table encoder   %6.2f ns/byte\n", table_ns);
+    printf("bit by bit      %6.2f ns/byte\n", bitwise_ns);
+    return 0;
+}
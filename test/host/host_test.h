@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+
+// Minimal checks for the host tests: report every failure, exit non-zero
+// from main() with TEST_RESULT()
+static int test_failures __attribute__((unused));
+
+#define TEST_CHECK(cond, ...)                                                  \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            test_failures++;                                                   \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);                        \
+            printf(__VA_ARGS__);                                               \
+            printf("\n");                                                      \
+        }                                                                      \
+    } while (0)
+
+#define TEST_RESULT() (printf("%s: %d failures\n", test_failures ? "FAILED" : "OK", test_failures), \
+                       test_failures != 0)
+
+static inline double test_now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Only the handle type, ws2812_control.h declares the encoder constructors
+typedef struct rmt_encoder_t *rmt_encoder_handle_t;
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// No hardware RNG on the host, effects without a seed take libc's
+static inline uint32_t esp_random(void)
+{
+    return (uint32_t)rand() << 16 ^ (uint32_t)rand();
+}
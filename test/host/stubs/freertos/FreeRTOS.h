@@ -0,0 +1,8 @@
+#pragma once
+
+// The host tests are single-threaded, critical sections do nothing
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux)  ((void)(mux))
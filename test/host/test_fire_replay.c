@@ -0,0 +1,61 @@
+// Fire with a fixed seed renders the same frames on every run and every
+// build: a hash of its first frames is compared with the one recorded when
+// the effect was written. A change to the effect or its generator that
+// alters the frames has to update FIRE_GOLDEN_HASH on purpose.
+#include <string.h>
+#include "host_test.h"
+#include "ws2812_effect.h"
+
+#define STRIP_LEDS      60
+#define FRAMES          500
+#define FIRE_SEED       12345
+#define FIRE_GOLDEN_HASH 0xba965564u
+
+static led_color_t pixels[STRIP_LEDS];
+static uint16_t scratch[STRIP_LEDS];
+static uint8_t led_state[STRIP_LEDS * ANIMATION_EFFECT_LED_STATE_SIZE];
+
+// FNV-1a over every frame of a run, steps of 1 to 3 so catching up after a
+// stall is covered too
+static uint32_t fire_run(uint32_t seed)
+{
+    const animation_effect_def_t *def = &animation_effects[ANIMATION_FIRE];
+    animation_config_t config = { .type = ANIMATION_FIRE, .speed = 50, .brightness = 255, .seed = seed };
+    uint8_t state[ANIMATION_EFFECT_STATE_SIZE] = { 0 };
+    memset(led_state, 0, sizeof(led_state));
+    animation_span_t span = {
+        .pixels = pixels,
+        .num_leds = STRIP_LEDS,
+        .scratch = scratch,
+        .led_state = led_state,
+        .palette = led_palette_lut(def->palette),
+    };
+    def->init(state, &config);
+
+    uint32_t hash = 2166136261u;
+    uint64_t phase = 0;
+    for (int f = 0; f < FRAMES; f++) {
+        uint32_t steps = 1 + f % 3;
+        phase += (uint64_t)steps << 16;
+        animation_clock_t clock = { .time_us = f * 16667LL, .phase = phase, .steps = steps };
+        def->render(state, &config, &span, &clock);
+        const uint8_t *bytes = (const uint8_t *)pixels;
+        for (size_t i = 0; i < sizeof(pixels); i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+int main(void)
+{
+    led_palette_update();
+    TEST_CHECK(animation_effects[ANIMATION_FIRE].init != NULL, "fire has no init to seed it");
+
+    uint32_t hash = fire_run(FIRE_SEED);
+    TEST_CHECK(hash == FIRE_GOLDEN_HASH, "seed %u replays to 0x%08x, recorded 0x%08x", FIRE_SEED, (unsigned)hash,
+               FIRE_GOLDEN_HASH);
+    TEST_CHECK(fire_run(FIRE_SEED) == hash, "a second run with the same seed differs");
+    TEST_CHECK(fire_run(FIRE_SEED + 1) != hash, "another seed renders the same frames");
+    return TEST_RESULT();
+}
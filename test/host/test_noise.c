@@ -0,0 +1,80 @@
+// Value noise stays in range for every octave count: a sum of octaves that
+// overflowed 16 bits would wrap, so besides the range every function is
+// checked for jumps between close points and against the others
+#include <stdlib.h>
+#include "host_test.h"
+#include "ws2812_noise.h"
+
+#define SAMPLES         20000
+#define FILL_LENGTH     300
+#define STEP            16   // Q16, 1/4096 of a cell
+#define MAX_JUMP        4096 // far more than noise moves over STEP, far less than a wrap
+
+static uint16_t fill16[FILL_LENGTH];
+static uint8_t fill8[FILL_LENGTH];
+
+static uint32_t random_coordinate(void)
+{
+    // Anywhere on the lattice, the last cells before it wraps around too
+    uint32_t value = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+    return rand() % 8 ? value : 0xFFFF0000u | (value & 0xFFFF);
+}
+
+static int jump(uint32_t a, uint32_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+int main(void)
+{
+    for (uint32_t octaves = 0; octaves <= LED_NOISE_MAX_OCTAVES + 1; octaves++) {
+        uint32_t low = 65535, high = 0;
+        for (int n = 0; n < SAMPLES; n++) {
+            uint32_t x = random_coordinate(), y = random_coordinate(), z = random_coordinate();
+            uint32_t value = led_noise16_octaves(x, y, z, octaves);
+            low = value < low ? value : low;
+            high = value > high ? value : high;
+            uint32_t next = led_noise16_octaves(x + STEP, y, z, octaves);
+            TEST_CHECK(jump(value, next) < MAX_JUMP, "%u octaves jump from %u to %u at x %08x", (unsigned)octaves,
+                       (unsigned)value, (unsigned)next, (unsigned)x);
+            next = led_noise16_octaves(x, y + STEP, z + STEP, octaves);
+            TEST_CHECK(jump(value, next) < MAX_JUMP, "%u octaves jump from %u to %u at y %08x z %08x",
+                       (unsigned)octaves, (unsigned)value, (unsigned)next, (unsigned)y, (unsigned)z);
+        }
+        // One octave reaches close to both ends, more of them average out
+        printf("%u octaves: %5u..%5u\n", (unsigned)octaves, (unsigned)low, (unsigned)high);
+        TEST_CHECK(low < 32768 && high >= 32768, "%u octaves stay within %u..%u", (unsigned)octaves, (unsigned)low,
+                   (unsigned)high);
+        if (octaves <= 1) {
+            TEST_CHECK(low < 4096 && high > 61439, "one octave only spans %u..%u", (unsigned)low, (unsigned)high);
+        }
+
+        // The fills are the points along a line, up to a rounding per octave
+        for (int n = 0; n < SAMPLES / FILL_LENGTH; n++) {
+            uint32_t x = random_coordinate(), y = random_coordinate(), z = random_coordinate();
+            uint32_t dx = rand() % 65536;
+            led_noise16_fill(fill16, FILL_LENGTH, x, dx, y, z, octaves);
+            led_noise8_fill(fill8, FILL_LENGTH, x, dx, y, z, octaves);
+            for (uint32_t i = 0; i < FILL_LENGTH; i++) {
+                uint32_t point = led_noise16_octaves(x + i * dx, y, z, octaves);
+                TEST_CHECK(jump(fill16[i], point) <= LED_NOISE_MAX_OCTAVES, "%u octaves fill %u, point %u",
+                           (unsigned)octaves, fill16[i], (unsigned)point);
+                TEST_CHECK(fill8[i] == fill16[i] >> 8, "%u octaves 8-bit fill %u, 16-bit %u", (unsigned)octaves,
+                           fill8[i], fill16[i]);
+            }
+        }
+    }
+
+    // The single-octave functions are the 3D noise in fewer dimensions
+    for (int n = 0; n < SAMPLES; n++) {
+        uint32_t x = random_coordinate(), y = random_coordinate();
+        TEST_CHECK(led_noise16_2d(x, y) == led_noise16_3d(x, y, 0), "2d differs at %08x %08x", (unsigned)x,
+                   (unsigned)y);
+        TEST_CHECK(led_noise16_1d(x) == led_noise16_3d(x, 0, 0), "1d differs at %08x", (unsigned)x);
+        TEST_CHECK(led_noise8_3d(x, y, 7) == led_noise16_3d(x, y, 7) >> 8, "8-bit 3d differs at %08x %08x",
+                   (unsigned)x, (unsigned)y);
+        TEST_CHECK(led_noise16_octaves(x, y, 0, 1) == led_noise16_2d(x, y), "one octave differs at %08x %08x",
+                   (unsigned)x, (unsigned)y);
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,71 @@
+// The packers against the output stage they implement: every 8.8 level,
+// scaled or not, is rounded without a dither buffer and comes out right on
+// average over 256 dithered frames
+#include <string.h>
+#include "host_test.h"
+#include "ws2812_pixel.h"
+
+static led_pixel_lut_t lut;
+static led_color_t src[256];
+static led_color_t dither[256];
+static uint8_t wire[256 * 4];
+
+static uint32_t level_of(const uint16_t *table, uint32_t level, uint16_t scale)
+{
+    return scale < LED_PIXEL_SCALE_FULL ? (table[level] * scale) >> 8 : table[level];
+}
+
+int main(void)
+{
+    led_pixel_lut_build(&lut, &(led_pixel_gamma_t){ .r = 220, .g = 220, .b = 180, .w = 100 });
+    for (int i = 0; i < 256; i++) {
+        // every level on every channel, each channel a different one
+        src[i] = (led_color_t){ .r = i, .g = 255 - i, .b = i * 7, .w = i * 13 };
+    }
+
+    static const uint16_t scales[] = { LED_PIXEL_SCALE_FULL, 255, 129, 64, 3, 0 };
+    led_pixel_packer_t pack = led_pixel_get_packer(LED_PIXEL_FORMAT_GRBW);
+    for (size_t s = 0; s < sizeof(scales) / sizeof(scales[0]); s++) {
+        uint16_t scale = scales[s];
+
+        pack(src, wire, 256, &lut, NULL, scale);
+        for (int i = 0; i < 256; i++) {
+            uint32_t expected[4] = {
+                level_of(lut.g, src[i].g, scale), level_of(lut.r, src[i].r, scale),
+                level_of(lut.b, src[i].b, scale), level_of(lut.w, src[i].w, scale),
+            };
+            for (int c = 0; c < 4; c++) {
+                TEST_CHECK(wire[i * 4 + c] == (expected[c] + 0x80) >> 8, "scale %u pixel %d channel %d rounds to %u",
+                           scale, i, c, wire[i * 4 + c]);
+            }
+        }
+
+        // 256 frames of the same pixels add up to the 8.8 level, up to the
+        // error the dither still holds
+        uint32_t sums[256][4] = { { 0 } };
+        memset(dither, 0x80, sizeof(dither));
+        for (int frame = 0; frame < 256; frame++) {
+            pack(src, wire, 256, &lut, dither, scale);
+            for (int i = 0; i < 256 * 4; i++) {
+                sums[i / 4][i % 4] += wire[i];
+            }
+        }
+        for (int i = 0; i < 256; i++) {
+            uint32_t expected[4] = {
+                level_of(lut.g, src[i].g, scale), level_of(lut.r, src[i].r, scale),
+                level_of(lut.b, src[i].b, scale), level_of(lut.w, src[i].w, scale),
+            };
+            for (int c = 0; c < 4; c++) {
+                TEST_CHECK(sums[i][c] == expected[c] || sums[i][c] + 1 == expected[c],
+                           "scale %u pixel %d channel %d dithers to %u/256, level %u", scale, i, c, sums[i][c],
+                           expected[c]);
+            }
+        }
+    }
+
+    // Channel order of the 3-byte formats
+    led_pixel_get_packer(LED_PIXEL_FORMAT_BGR)(src + 200, wire, 1, &lut, NULL, LED_PIXEL_SCALE_FULL);
+    TEST_CHECK(wire[0] == (lut.b[src[200].b] + 0x80) >> 8 && wire[2] == (lut.r[src[200].r] + 0x80) >> 8,
+               "bgr order");
+    return TEST_RESULT();
+}
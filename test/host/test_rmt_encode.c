@@ -0,0 +1,103 @@
+// The table encoder against the expansion the generic RMT bytes encoder
+// does: MSB first, bit0 or bit1 per data bit, then the reset code.
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+#include "ws2812_rmt_encode.h"
+
+#define RESOLUTION_HZ   10000000
+#define STREAM_BYTES    (256 + 300)
+
+// The layout of rmt_symbol_word_t in driver/rmt_types.h
+typedef union {
+    struct {
+        uint16_t duration0 : 15;
+        uint16_t level0 : 1;
+        uint16_t duration1 : 15;
+        uint16_t level1 : 1;
+    };
+    uint32_t val;
+} rmt_symbol_word_t;
+
+static led_rmt_table_t table;
+static uint8_t stream[STREAM_BYTES];
+static uint32_t expected[STREAM_BYTES * 8 + 1];
+static uint32_t encoded[STREAM_BYTES * 8 + 1];
+
+static size_t reference_encode(const led_timing_ticks_t *ticks, const uint8_t *data, size_t size, uint32_t *out)
+{
+    rmt_symbol_word_t bit0 = { .level0 = 1, .duration0 = ticks->t0h, .level1 = 0, .duration1 = ticks->t0l };
+    rmt_symbol_word_t bit1 = { .level0 = 1, .duration0 = ticks->t1h, .level1 = 0, .duration1 = ticks->t1l };
+    rmt_symbol_word_t reset = { .level0 = 0, .duration0 = ticks->reset_half, .level1 = 0, .duration1 = ticks->reset_half };
+    size_t n = 0;
+    for (size_t i = 0; i < size; i++) {
+        for (int bit = 7; bit >= 0; bit--) {
+            out[n++] = (data[i] >> bit & 1) ? bit1.val : bit0.val;
+        }
+    }
+    out[n++] = reset.val;
+    return n;
+}
+
+// Run the callback like the simple encoder does: it offers the room left in
+// the channel memory, and a block that cannot take another byte is sent and
+// refilled from the start. With mem_symbols 0 every call offers a random
+// amount of room instead.
+static size_t table_encode(const uint8_t *data, size_t size, size_t mem_symbols, uint32_t *out)
+{
+    size_t written = 0;
+    size_t used = 0;
+    bool done = false;
+    int stalls = 0;
+    while (!done && stalls < 2) {
+        size_t room = mem_symbols ? mem_symbols - used : (size_t)(rand() % 40);
+        size_t n = led_rmt_table_encode(&table, data, size, written, room, out + written, &done);
+        TEST_CHECK(n <= room, "wrote %zu symbols into room for %zu", n, room);
+        if (n == 0) {
+            used = 0; // block full, the ISR refills it from the start
+            stalls = mem_symbols ? stalls + 1 : 0;
+            continue;
+        }
+        stalls = 0;
+        written += n;
+        used += n;
+    }
+    TEST_CHECK(done, "no progress with %zu symbols of channel memory", mem_symbols);
+    return written;
+}
+
+int main(void)
+{
+    for (int i = 0; i < STREAM_BYTES; i++) {
+        stream[i] = i < 256 ? i : rand(); // every byte value, then noise
+    }
+
+    for (int profile = 0; profile < LED_TIMING_MAX; profile++) {
+        led_timing_ticks_t ticks;
+        TEST_CHECK(led_timing_to_ticks(led_timing_get(profile), RESOLUTION_HZ, &ticks), "profile %d", profile);
+        led_rmt_table_build(&table, &ticks);
+
+        // Every byte value on its own
+        for (int value = 0; value < 256; value++) {
+            uint8_t byte = value;
+            size_t n = reference_encode(&ticks, &byte, 1, expected);
+            TEST_CHECK(memcmp(table.symbols[value], expected, 8 * sizeof(uint32_t)) == 0,
+                       "profile %d byte 0x%02x", profile, value);
+            TEST_CHECK(table.reset == expected[n - 1], "profile %d reset code", profile);
+        }
+
+        // Whole streams at every channel memory size, including ones that
+        // do not hold a whole number of bytes
+        size_t n = reference_encode(&ticks, stream, STREAM_BYTES, expected);
+        for (size_t mem_symbols = 0; mem_symbols <= 200; mem_symbols++) {
+            if (mem_symbols > 0 && mem_symbols < LED_RMT_SYMBOLS_PER_BYTE) {
+                continue; // the simple encoder needs min_chunk_size of 8
+            }
+            memset(encoded, 0, sizeof(encoded));
+            size_t written = table_encode(stream, STREAM_BYTES, mem_symbols, encoded);
+            TEST_CHECK(written == n && memcmp(encoded, expected, n * sizeof(uint32_t)) == 0,
+                       "profile %d with %zu symbols of channel memory", profile, mem_symbols);
+        }
+    }
+    return TEST_RESULT();
+}
@@ -0,0 +1,99 @@
+// SPI codes chosen for every timing profile, and the encoded bit stream
+// against a bit-by-bit expansion of the same code
+#include <string.h>
+#include "host_test.h"
+#include "ws2812_config.h"
+#include "ws2812_spi_encode.h"
+
+static const struct {
+    led_timing_profile_t profile;
+    int bits_per_bit;          // 0 if SPI must refuse the profile
+    int zero_bits;
+    int one_bits;
+} expected_codes[] = {
+    { LED_TIMING_WS2812B, 3, 1, 2 },
+    { LED_TIMING_WS2811, 4, 1, 2 },
+    { LED_TIMING_SK6812, 4, 1, 2 },
+    { LED_TIMING_APA106, 4, 1, 3 },
+    { LED_TIMING_WS2815, 3, 1, 2 },
+};
+
+static uint32_t abs_diff(uint32_t a, uint32_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+// Append one SPI bit per call, MSB first
+static void put_bit(uint8_t *dst, size_t *pos, int bit)
+{
+    if (bit) {
+        dst[*pos / 8] |= 0x80 >> (*pos % 8);
+    }
+    (*pos)++;
+}
+
+int main(void)
+{
+    for (size_t i = 0; i < sizeof(expected_codes) / sizeof(expected_codes[0]); i++) {
+        const led_timing_t *timing = led_timing_get(expected_codes[i].profile);
+        led_spi_code_t code;
+        uint32_t clock_hz = 0;
+        bool fits = led_spi_code_for_timing(timing, LED_STRIP_SPI_TOLERANCE_NS, &code, &clock_hz);
+        TEST_CHECK(fits == (expected_codes[i].bits_per_bit != 0), "%s fits: %d", timing->name, fits);
+        if (!fits) {
+            continue;
+        }
+        TEST_CHECK(code.bits_per_bit == expected_codes[i].bits_per_bit && code.zero_bits == expected_codes[i].zero_bits &&
+                   code.one_bits == expected_codes[i].one_bits, "%s code %d/%d/%d", timing->name,
+                   code.bits_per_bit, code.zero_bits, code.one_bits);
+
+        // Every pulse on the wire within the tolerance of the datasheet
+        uint32_t bit_ns = 1000000000u / clock_hz;
+        TEST_CHECK(abs_diff(code.zero_bits * bit_ns, timing->t0h_ns) <= LED_STRIP_SPI_TOLERANCE_NS &&
+                   abs_diff((code.bits_per_bit - code.zero_bits) * bit_ns, timing->t0l_ns) <= LED_STRIP_SPI_TOLERANCE_NS &&
+                   abs_diff(code.one_bits * bit_ns, timing->t1h_ns) <= LED_STRIP_SPI_TOLERANCE_NS &&
+                   abs_diff((code.bits_per_bit - code.one_bits) * bit_ns, timing->t1l_ns) <= LED_STRIP_SPI_TOLERANCE_NS,
+                   "%s pulses at %u Hz", timing->name, clock_hz);
+
+        // Every byte value against a bit-by-bit expansion
+        uint8_t src[256];
+        uint8_t encoded[256 * LED_SPI_MAX_BITS_PER_BIT];
+        uint8_t expected[256 * LED_SPI_MAX_BITS_PER_BIT];
+        for (int value = 0; value < 256; value++) {
+            src[value] = value;
+        }
+        memset(expected, 0, sizeof(expected));
+        size_t pos = 0;
+        for (int value = 0; value < 256; value++) {
+            for (int bit = 7; bit >= 0; bit--) {
+                int high = (value >> bit & 1) ? code.one_bits : code.zero_bits;
+                for (int spi_bit = 0; spi_bit < code.bits_per_bit; spi_bit++) {
+                    put_bit(expected, &pos, spi_bit < high);
+                }
+            }
+        }
+        size_t size = led_spi_encode(src, 256, encoded, &code);
+        TEST_CHECK(size == led_spi_encoded_size(256, &code) && size == pos / 8, "%s size %zu", timing->name, size);
+        TEST_CHECK(memcmp(encoded, expected, size) == 0, "%s bit stream", timing->name);
+    }
+
+    led_spi_code_t code;
+    TEST_CHECK(!led_spi_code_init(&code, 5, 1, 2), "5 bits per bit do not fit the nibble table");
+    TEST_CHECK(!led_spi_code_init(&code, 3, 2, 2), "a 1 must be longer than a 0");
+    TEST_CHECK(!led_spi_code_init(&code, 4, 1, 4), "a 1 needs a low bit");
+
+    // A timing no code can match is refused instead of sent out of spec
+    led_timing_t odd = { "odd", 200, 2000, 2100, 100, 50 };
+    uint32_t clock_hz;
+    TEST_CHECK(!led_spi_code_for_timing(&odd, LED_STRIP_SPI_TOLERANCE_NS, &code, &clock_hz), "odd timing refused");
+
+    // A custom timing whose 1 bit is longer is clocked for the 1 bit, the 0
+    // bit's low time stretches within the tolerance
+    led_timing_t uneven = { "uneven", 400, 800, 800, 500, 50 };
+    TEST_CHECK(led_timing_period_ns(&uneven) == 1300, "uneven period %u", (unsigned)led_timing_period_ns(&uneven));
+    TEST_CHECK(led_spi_code_for_timing(&uneven, LED_STRIP_SPI_TOLERANCE_NS, &code, &clock_hz) &&
+                   clock_hz == led_timing_bit_rate_hz(&uneven) * code.bits_per_bit &&
+                   led_timing_bit_rate_hz(&uneven) == 1000000000UL / 1300,
+               "uneven timing clocked at %u Hz", (unsigned)clock_hz);
+    return TEST_RESULT();
+}